@@ -0,0 +1,465 @@
+#include "benchmark.h"
+
+#include <algorithm> /// For std::min and std::max
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <new>
+#include <regex>
+#include <sstream>
+#include <string_view>
+#include <thread>
+
+#if defined(__linux__)
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+/// Counts every heap allocation of the process. Only the counts inside the
+/// timed regions of a run are reported.
+namespace {
+std::atomic<std::uint64_t> allocationCount{0};
+std::atomic<std::uint64_t> allocationBytes{0};
+
+void* countedAllocate(const std::size_t size) {
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	allocationBytes.fetch_add(size, std::memory_order_relaxed);
+	if (void* pointer = std::malloc(size == 0 ? 1 : size))
+		return pointer;
+	throw std::bad_alloc();
+}
+
+void* countedAllocate(const std::size_t size, const std::align_val_t alignment) {
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	allocationBytes.fetch_add(size, std::memory_order_relaxed);
+	const auto align = static_cast<std::size_t>(alignment);
+	/// aligned_alloc wants a multiple of the alignment
+	if (void* pointer = std::aligned_alloc(align, std::max(align, (size + align - 1) / align * align)))
+		return pointer;
+	throw std::bad_alloc();
+}
+} /// namespace
+
+void* operator new(const std::size_t size) { return countedAllocate(size); }
+void* operator new[](const std::size_t size) { return countedAllocate(size); }
+void* operator new(const std::size_t size, const std::align_val_t alignment) {
+	return countedAllocate(size, alignment);
+}
+void* operator new[](const std::size_t size, const std::align_val_t alignment) {
+	return countedAllocate(size, alignment);
+}
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept { std::free(pointer); }
+
+namespace lillugsi::planet::bench {
+namespace {
+/// Process CPU time, all threads
+double processCpuSeconds() {
+#if defined(__linux__)
+	timespec time{};
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+	return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_nsec) * 1e-9;
+#else
+	return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+#endif
+}
+
+/// Resets the peak resident set size to the current one, false where that is not possible.
+/// Memory freed by earlier runs is returned to the system first, so it does not count.
+bool resetPeakMemory() {
+#if defined(__GLIBC__)
+	malloc_trim(0);
+#endif
+#if defined(__linux__)
+	std::ofstream file("/proc/self/clear_refs");
+	file << "5";
+	return static_cast<bool>(file.flush());
+#else
+	return false;
+#endif
+}
+
+/// Peak resident set size in bytes since the last reset, 0 if unknown
+std::uint64_t peakMemory() {
+#if defined(__linux__)
+	std::ifstream file("/proc/self/status");
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.rfind("VmHWM:", 0) == 0)
+			return std::strtoull(line.c_str() + 6, nullptr, 10) * 1024;
+	}
+	rusage usage{};
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+		return static_cast<std::uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+	return 0;
+}
+
+struct Registration {
+	std::string name;
+	BenchmarkFunction function;
+	std::vector<std::int64_t> arguments;
+};
+
+std::vector<Registration>& registry() {
+	static std::vector<Registration> registrations;
+	return registrations;
+}
+
+struct Report {
+	std::string name;
+	std::int64_t iterations{0};
+	double realNanoseconds{0.0}; /// Per iteration
+	double cpuNanoseconds{0.0};
+	double itemsPerSecond{0.0};
+	double bytesPerSecond{0.0};
+	double allocations{0.0}; /// Per iteration
+	double allocatedBytes{0.0};
+	std::uint64_t peakMemoryBytes{0};
+	bool peakMemoryReset{false};
+	std::string label;
+	std::string error;
+};
+
+struct Options {
+	std::string filter{"."};
+	double minTime{0.5};
+	bool json{false};
+	std::string outPath;
+	bool list{false};
+};
+
+bool startsWith(const std::string_view text, const std::string_view prefix) {
+	return text.substr(0, prefix.size()) == prefix;
+}
+
+bool parseOptions(const int argc, char** argv, Options& options) {
+	for (int index = 1; index < argc; ++index) {
+		const std::string_view argument = argv[index];
+		const auto value = [&argument]() { return std::string(argument.substr(argument.find('=') + 1)); };
+		if (startsWith(argument, "--benchmark_filter="))
+			options.filter = value();
+		else if (startsWith(argument, "--benchmark_min_time="))
+			options.minTime = std::strtod(value().c_str(), nullptr); /// "0.5" and "0.5s" both parse
+		else if (argument == "--benchmark_format=json")
+			options.json = true;
+		else if (argument == "--benchmark_format=console")
+			options.json = false;
+		else if (startsWith(argument, "--benchmark_out="))
+			options.outPath = value();
+		else if (argument == "--benchmark_out_format=json")
+			continue; /// The only file format
+		else if (argument == "--benchmark_list_tests" || argument == "--benchmark_list_tests=true")
+			options.list = true;
+		else {
+			std::fprintf(stderr, "unknown flag %s\nflags: --benchmark_filter=<regex> --benchmark_min_time=<seconds> "
+				"--benchmark_format=<console|json> --benchmark_out=<file> --benchmark_list_tests\n", argv[index]);
+			return false;
+		}
+	}
+	return true;
+}
+
+std::string runName(const Registration& registration) {
+	std::string name = registration.name;
+	for (const std::int64_t argument : registration.arguments) {
+		name += '/';
+		name += std::to_string(argument);
+	}
+	return name;
+}
+
+std::string jsonString(const std::string& text) {
+	std::string result = "\"";
+	for (const char character : text) {
+		if (character == '"' || character == '\\') {
+			result += '\\';
+			result += character;
+		} else if (static_cast<unsigned char>(character) < 0x20) {
+			char escaped[8];
+			std::snprintf(escaped, sizeof(escaped), "\\u%04x", character);
+			result += escaped;
+		} else {
+			result += character;
+		}
+	}
+	return result + "\"";
+}
+
+std::string jsonNumber(const double value) {
+	if (!std::isfinite(value))
+		return "0";
+	char text[32];
+	std::snprintf(text, sizeof(text), "%.17g", value);
+	return text;
+}
+
+std::string toJson(const std::vector<Report>& reports, const char* executable) {
+	char date[64];
+	const std::time_t now = std::time(nullptr);
+	std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", std::localtime(&now));
+	char host[256] = "unknown";
+#if defined(__linux__)
+	gethostname(host, sizeof(host) - 1);
+#endif
+
+	std::ostringstream json;
+	json << "{\n  \"context\": {\n";
+	json << "    \"date\": " << jsonString(date) << ",\n";
+	json << "    \"host_name\": " << jsonString(host) << ",\n";
+	json << "    \"executable\": " << jsonString(executable) << ",\n";
+	json << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+#if defined(NDEBUG)
+	json << "    \"library_build_type\": \"release\"\n";
+#else
+	json << "    \"library_build_type\": \"debug\"\n";
+#endif
+	json << "  },\n  \"benchmarks\": [";
+	for (std::size_t index = 0; index < reports.size(); ++index) {
+		const Report& report = reports[index];
+		json << (index == 0 ? "\n" : ",\n") << "    {\n";
+		json << "      \"name\": " << jsonString(report.name) << ",\n";
+		json << "      \"run_name\": " << jsonString(report.name) << ",\n";
+		json << "      \"run_type\": \"iteration\",\n";
+		if (!report.error.empty()) {
+			json << "      \"error_occurred\": true,\n";
+			json << "      \"error_message\": " << jsonString(report.error) << ",\n";
+		}
+		json << "      \"iterations\": " << report.iterations << ",\n";
+		json << "      \"real_time\": " << jsonNumber(report.realNanoseconds) << ",\n";
+		json << "      \"cpu_time\": " << jsonNumber(report.cpuNanoseconds) << ",\n";
+		json << "      \"time_unit\": \"ns\",\n";
+		if (report.itemsPerSecond > 0.0)
+			json << "      \"items_per_second\": " << jsonNumber(report.itemsPerSecond) << ",\n";
+		if (report.bytesPerSecond > 0.0)
+			json << "      \"bytes_per_second\": " << jsonNumber(report.bytesPerSecond) << ",\n";
+		if (!report.label.empty())
+			json << "      \"label\": " << jsonString(report.label) << ",\n";
+		json << "      \"allocations\": " << jsonNumber(report.allocations) << ",\n";
+		json << "      \"allocated_bytes\": " << jsonNumber(report.allocatedBytes) << ",\n";
+		json << "      \"peak_rss_bytes\": " << report.peakMemoryBytes << ",\n";
+		json << "      \"peak_rss_is_per_run\": " << (report.peakMemoryReset ? "true" : "false") << "\n";
+		json << "    }";
+	}
+	json << "\n  ]\n}\n";
+	return json.str();
+}
+
+/// Value with an SI prefix, e.g. 12.3M
+std::string humanReadable(double value, const char* unit) {
+	static constexpr std::array<const char*, 5> Prefixes = {"", "k", "M", "G", "T"};
+	std::size_t prefix = 0;
+	while (value >= 1000.0 && prefix + 1 < Prefixes.size()) {
+		value /= 1000.0;
+		++prefix;
+	}
+	char text[32];
+	std::snprintf(text, sizeof(text), "%.4g%s%s", value, Prefixes[prefix], unit);
+	return text;
+}
+
+std::string formatTime(const double nanoseconds) {
+	char text[32];
+	if (nanoseconds >= 1e9)
+		std::snprintf(text, sizeof(text), "%.3f s", nanoseconds * 1e-9);
+	else if (nanoseconds >= 1e6)
+		std::snprintf(text, sizeof(text), "%.3f ms", nanoseconds * 1e-6);
+	else if (nanoseconds >= 1e3)
+		std::snprintf(text, sizeof(text), "%.3f us", nanoseconds * 1e-3);
+	else
+		std::snprintf(text, sizeof(text), "%.1f ns", nanoseconds);
+	return text;
+}
+
+void printConsoleHeader(const std::size_t nameWidth) {
+	std::printf("%-*s %13s %13s %10s  %s\n", static_cast<int>(nameWidth), "Benchmark", "Time", "CPU", "Iterations",
+		"Counters");
+	std::printf("%s\n", std::string(nameWidth + 40 + 60, '-').c_str());
+}
+
+void printConsole(const Report& report, const std::size_t nameWidth) {
+	if (!report.error.empty()) {
+		std::printf("%-*s ERROR: %s\n", static_cast<int>(nameWidth), report.name.c_str(), report.error.c_str());
+		return;
+	}
+	std::printf("%-*s %13s %13s %10lld ", static_cast<int>(nameWidth), report.name.c_str(),
+		formatTime(report.realNanoseconds).c_str(), formatTime(report.cpuNanoseconds).c_str(),
+		static_cast<long long>(report.iterations));
+	if (report.itemsPerSecond > 0.0)
+		std::printf(" items/s=%s", humanReadable(report.itemsPerSecond, "").c_str());
+	if (report.bytesPerSecond > 0.0)
+		std::printf(" bytes/s=%s", humanReadable(report.bytesPerSecond, "B").c_str());
+	std::printf(" allocs/iter=%s peak_rss=%s%s", humanReadable(report.allocations, "").c_str(),
+		humanReadable(static_cast<double>(report.peakMemoryBytes), "B").c_str(), report.peakMemoryReset ? "" : "*");
+	if (!report.label.empty())
+		std::printf(" %s", report.label.c_str());
+	std::printf("\n");
+	std::fflush(stdout);
+}
+} /// namespace
+
+/// Runs one registration with growing iteration counts until a run takes the minimum time
+class Runner {
+public:
+	static Report run(const Registration& registration, const double minTime) {
+		Report report;
+		report.name = runName(registration);
+
+		std::int64_t iterations = 1;
+		while (true) {
+			report.peakMemoryReset = resetPeakMemory();
+			State state(registration.arguments, iterations);
+			registration.function(state);
+			report.peakMemoryBytes = peakMemory();
+			if (!state.error.empty()) {
+				report.error = state.error;
+				return report;
+			}
+			if (state.completed != iterations || state.running) {
+				report.error = "the benchmark did not finish its keepRunning loop";
+				return report;
+			}
+
+			/// Like Google Benchmark: stop once the minimum time is reached, else scale up,
+			/// by at most 10 at a time and aiming 40% above the minimum
+			constexpr std::int64_t MaxIterations = 1000000000;
+			if (state.realSeconds >= minTime || iterations >= MaxIterations) {
+				const auto count = static_cast<double>(iterations);
+				report.iterations = iterations;
+				report.realNanoseconds = state.realSeconds * 1e9 / count;
+				report.cpuNanoseconds = state.cpuSeconds * 1e9 / count;
+				if (state.realSeconds > 0.0) {
+					report.itemsPerSecond = static_cast<double>(state.itemsProcessed) / state.realSeconds;
+					report.bytesPerSecond = static_cast<double>(state.bytesProcessed) / state.realSeconds;
+				}
+				report.allocations = static_cast<double>(state.allocations) / count;
+				report.allocatedBytes = static_cast<double>(state.allocatedBytes) / count;
+				report.label = state.label;
+				return report;
+			}
+			const double multiplier = state.realSeconds <= minTime / 10.0 ? 10.0 : 1.4 * minTime / state.realSeconds;
+			iterations = std::min(MaxIterations,
+				std::max(iterations + 1, static_cast<std::int64_t>(static_cast<double>(iterations) * multiplier)));
+		}
+	}
+};
+
+State::State(std::vector<std::int64_t> arguments, const std::int64_t iterations)
+: arguments(std::move(arguments)), iterations(iterations) {}
+
+bool State::keepRunning() {
+	if (!this->started) {
+		this->started = true;
+		if (!this->error.empty())
+			return false;
+		this->resumeTiming();
+	} else {
+		++this->completed;
+	}
+	if (this->completed < this->iterations && this->error.empty())
+		return true;
+	if (this->running)
+		this->pauseTiming();
+	return false;
+}
+
+void State::pauseTiming() {
+	if (!this->running)
+		return;
+	this->realSeconds += std::chrono::duration<double>(Clock::now() - this->realStart).count();
+	this->cpuSeconds += processCpuSeconds() - this->cpuStart;
+	this->allocations += allocationCount.load(std::memory_order_relaxed) - this->allocationsStart;
+	this->allocatedBytes += allocationBytes.load(std::memory_order_relaxed) - this->allocatedBytesStart;
+	this->running = false;
+}
+
+void State::resumeTiming() {
+	if (this->running)
+		return;
+	this->running = true;
+	this->allocationsStart = allocationCount.load(std::memory_order_relaxed);
+	this->allocatedBytesStart = allocationBytes.load(std::memory_order_relaxed);
+	this->cpuStart = processCpuSeconds();
+	this->realStart = Clock::now();
+}
+
+void State::skipWithError(std::string message) {
+	this->error = std::move(message);
+}
+
+void registerBenchmark(const std::string& name, BenchmarkFunction function,
+	const std::vector<std::vector<std::int64_t>>& argumentSets) {
+	for (const std::vector<std::int64_t>& arguments : argumentSets) {
+		registry().push_back({name, function, arguments});
+	}
+}
+
+int runBenchmarks(const int argc, char** argv) {
+	Options options;
+	if (!parseOptions(argc, argv, options))
+		return 1;
+
+	std::regex filter;
+	try {
+		filter = std::regex(options.filter);
+	} catch (const std::regex_error&) {
+		std::fprintf(stderr, "invalid --benchmark_filter %s\n", options.filter.c_str());
+		return 1;
+	}
+	std::vector<const Registration*> selected;
+	std::size_t nameWidth = 10;
+	for (const Registration& registration : registry()) {
+		const std::string name = runName(registration);
+		if (std::regex_search(name, filter)) {
+			selected.push_back(&registration);
+			nameWidth = std::max(nameWidth, name.size());
+		}
+	}
+	if (options.list) {
+		for (const Registration* registration : selected) {
+			std::printf("%s\n", runName(*registration).c_str());
+		}
+		return 0;
+	}
+
+	if (!options.json)
+		printConsoleHeader(nameWidth);
+	std::vector<Report> reports;
+	bool failed = false;
+	for (const Registration* registration : selected) {
+		reports.push_back(Runner::run(*registration, options.minTime));
+		failed = failed || !reports.back().error.empty();
+		if (!options.json)
+			printConsole(reports.back(), nameWidth);
+	}
+	if (!options.json && !reports.empty() && !reports.front().peakMemoryReset)
+		std::printf("* peak RSS of the whole process, it could not be reset per run\n");
+
+	const std::string json = toJson(reports, argv[0]);
+	if (options.json)
+		std::fputs(json.c_str(), stdout);
+	if (!options.outPath.empty()) {
+		std::ofstream file(options.outPath);
+		file << json;
+		if (!file) {
+			std::fprintf(stderr, "could not write %s\n", options.outPath.c_str());
+			return 1;
+		}
+	}
+	return failed ? 1 : 0;
+}
+} /// namespace lillugsi::planet::bench
@@ -0,0 +1,93 @@
+#pragma once
+
+/// Small benchmark harness in the style of Google Benchmark, without the dependency.
+/// Benchmarks are registered with a list of argument sets, each set becomes one run
+/// named name/arg0/arg1/... . A run repeats its loop until it takes at least the
+/// minimum time, then reports the time per iteration, throughput, the allocations
+/// made inside the timed region and the peak resident set size.
+/// The JSON output follows the Google Benchmark schema, so its compare.py can diff
+/// two result files.
+///
+/// Flags:
+///   --benchmark_filter=<regex>         runs whose name matches (default all)
+///   --benchmark_min_time=<seconds>     minimum time per run (default 0.5)
+///   --benchmark_format=<console|json>  format on stdout (default console)
+///   --benchmark_out=<file>             additionally writes JSON to a file
+///   --benchmark_list_tests             prints the run names and exits
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace lillugsi::planet::bench {
+class State {
+public:
+	/// Timed loop: while (state.keepRunning()) { ... }
+	[[nodiscard]] bool keepRunning();
+
+	/// Excludes setup and teardown inside the loop from time and allocation counts
+	void pauseTiming();
+	void resumeTiming();
+
+	[[nodiscard]] std::int64_t getArgument(std::size_t index) const { return this->arguments[index]; }
+	[[nodiscard]] std::int64_t getIterations() const { return this->iterations; }
+
+	/// Totals over all iterations, reported per second
+	void setItemsProcessed(std::int64_t items) { this->itemsProcessed = items; }
+	void setBytesProcessed(std::int64_t bytes) { this->bytesProcessed = bytes; }
+	void setLabel(std::string text) { this->label = std::move(text); }
+	/// Marks the run as failed, call it before the loop or break out of the loop afterwards
+	void skipWithError(std::string message);
+
+private:
+	friend class Runner;
+	using Clock = std::chrono::steady_clock;
+
+	State(std::vector<std::int64_t> arguments, std::int64_t iterations);
+
+	std::vector<std::int64_t> arguments;
+	std::int64_t iterations;
+	std::int64_t completed{0};
+	bool started{false};
+	bool running{false};
+
+	/// Accumulated over the timed regions
+	double realSeconds{0.0};
+	double cpuSeconds{0.0};
+	std::uint64_t allocations{0};
+	std::uint64_t allocatedBytes{0};
+
+	/// Values at the start of the current timed region
+	Clock::time_point realStart;
+	double cpuStart{0.0};
+	std::uint64_t allocationsStart{0};
+	std::uint64_t allocatedBytesStart{0};
+
+	std::int64_t itemsProcessed{0};
+	std::int64_t bytesProcessed{0};
+	std::string label;
+	std::string error;
+};
+
+using BenchmarkFunction = std::function<void(State&)>;
+
+/// Keeps the compiler from dropping a computation whose result is otherwise unused
+template <typename T>
+void doNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "r,m"(value) : "memory");
+#else
+	static volatile const T* sink;
+	sink = &value;
+#endif
+}
+
+/// Registers one run per argument set, an empty set gives a run named just name
+void registerBenchmark(const std::string& name, BenchmarkFunction function,
+	const std::vector<std::vector<std::int64_t>>& argumentSets = {{}});
+
+/// Parses the flags, runs the matching benchmarks and reports them. Returns the exit code.
+int runBenchmarks(int argc, char** argv);
+} /// namespace lillugsi::planet::bench
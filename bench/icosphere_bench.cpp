@@ -0,0 +1,332 @@
+/// Regression benchmark suite: subdivision, neighbor setup, point location, visitor
+/// traversal, export and sphere files, each over a range of levels. See benchmark.h for the flags.
+/// Compare two releases with
+///   icosphere_bench --benchmark_out=old.json   (and new.json)
+///   compare.py benchmarks old.json new.json    (from Google Benchmark's tools)
+/// Storage arguments: 0 tree, 1 flat. Point sets: 0 random, 1 coherent.
+
+#include "benchmark.h"
+#include "icosphere.h"
+#include "meshexporter.h"
+#include "spherefile.h"
+
+#include <cmath>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace lillugsi::planet;
+using lillugsi::planet::bench::State;
+
+namespace {
+constexpr unsigned int MaxLevel = 10;
+/// A tree mode sphere of level 10 needs over 5 GB for its Face nodes
+constexpr unsigned int MaxTreeLevel = 8;
+constexpr std::size_t PointCount = 1 << 16;
+
+enum class PointSet {
+	Random,
+	Coherent
+};
+
+FaceStorage storageOf(const State& state) {
+	return state.getArgument(0) == 0 ? FaceStorage::Tree : FaceStorage::Flat;
+}
+
+unsigned int levelOf(const State& state, const std::size_t index) {
+	return static_cast<unsigned int>(state.getArgument(index));
+}
+
+/// Faces of all levels up to level
+std::int64_t faceCount(const unsigned int level) {
+	return faceid::levelOffset(level + 1);
+}
+
+/// One subdivided sphere shared by consecutive runs, rebuilt outside the timed region
+/// when storage or level change. Keeping just one bounds the memory.
+Icosphere& sharedIcosphere(const FaceStorage storage, const unsigned int level) {
+	static std::unique_ptr<Icosphere> icosphere;
+	if (!icosphere || icosphere->getFaceStorage() != storage || icosphere->getLevelCount() != level + 1) {
+		icosphere.reset();
+		icosphere = std::make_unique<Icosphere>(storage);
+		icosphere->subdivide(static_cast<int>(level), 0);
+	}
+	return *icosphere;
+}
+
+/// Random: uniform on the sphere. Coherent: a random walk with steps of about a quarter
+/// face edge on the level, so consecutive points mostly fall into the same or a
+/// neighboring face, like samples along a path or a scan line.
+std::vector<Vector3> makePoints(const PointSet set, const unsigned int level) {
+	std::mt19937 generator(42);
+	std::normal_distribution<float> distribution;
+	const auto randomDirection = [&]() {
+		return Vector3(distribution(generator), distribution(generator), distribution(generator)).normalized();
+	};
+	std::vector<Vector3> points(PointCount);
+	if (set == PointSet::Random) {
+		for (Vector3& point : points) {
+			point = randomDirection();
+		}
+		return points;
+	}
+	const float step = 1.1f / static_cast<float>(1u << level) * 0.25f;
+	Vector3 point = randomDirection();
+	Vector3 heading = randomDirection();
+	for (Vector3& result : points) {
+		/// Keep the heading tangential and turn it a little every step
+		heading = heading + randomDirection() * 0.2f;
+		heading = (heading - point * heading.dot(point)).normalized();
+		point = (point + heading * step).normalized();
+		result = point;
+	}
+	return points;
+}
+
+/// Light visitor, so the traversal and not the visit dominates
+class SumVisitor : public FaceVisitor {
+public:
+	void visit(const std::shared_ptr<Face> face) override { this->sum += face->getData(); }
+	void visit(FaceStore& faces, const FaceId id) override { this->sum += faces.getData(id); }
+	void visit(FaceChannel<float>& channel, const FaceId id) override { this->sum += channel[id]; }
+
+	double sum{0.0};
+};
+
+void subdivide(State& state) {
+	const FaceStorage storage = storageOf(state);
+	const unsigned int level = levelOf(state, 1);
+	while (state.keepRunning()) {
+		state.pauseTiming();
+		auto icosphere = std::make_unique<Icosphere>(storage);
+		state.resumeTiming();
+		icosphere->subdivide(static_cast<int>(level), 1);
+		state.pauseTiming();
+		icosphere.reset();
+		state.resumeTiming();
+	}
+	state.setItemsProcessed(state.getIterations() * faceCount(level));
+}
+
+/// The neighbor setup subdivide ends with, through Icosphere::updateNeighbors for every
+/// face of every level, tree mode mirroring included
+void neighborSetup(State& state) {
+	const FaceStorage storage = storageOf(state);
+	const unsigned int level = levelOf(state, 1);
+	Icosphere& icosphere = sharedIcosphere(storage, level);
+	while (state.keepRunning()) {
+		icosphere.updateNeighbors(1);
+	}
+	state.setItemsProcessed(state.getIterations() * faceCount(level));
+}
+
+void getFaceAtPoint(State& state) {
+	const FaceStorage storage = storageOf(state);
+	const auto set = static_cast<PointSet>(state.getArgument(1));
+	const unsigned int level = levelOf(state, 2);
+	const Icosphere& icosphere = sharedIcosphere(storage, level);
+	const std::vector<Vector3> points = makePoints(set, level);
+	std::size_t found = 0;
+	while (state.keepRunning()) {
+		if (storage == FaceStorage::Tree) {
+			for (const Vector3& point : points) {
+				found += icosphere.getFaceAtPoint(point) != nullptr;
+			}
+		} else {
+			for (const Vector3& point : points) {
+				found += icosphere.getFaceIdAtPoint(point) != InvalidFaceId;
+			}
+		}
+	}
+	if (found != points.size() * static_cast<std::size_t>(state.getIterations()))
+		state.skipWithError("a point was not located");
+	state.setItemsProcessed(state.getIterations() * static_cast<std::int64_t>(points.size()));
+}
+
+/// applyVisitor in the storage's own mode, the visitor sees every face of every level
+void applyVisitor(State& state) {
+	const FaceStorage storage = storageOf(state);
+	const unsigned int level = levelOf(state, 1);
+	Icosphere& icosphere = sharedIcosphere(storage, level);
+	SumVisitor visitor;
+	while (state.keepRunning()) {
+		icosphere.applyVisitor(visitor);
+	}
+	lillugsi::planet::bench::doNotOptimize(visitor.sum);
+	state.setItemsProcessed(state.getIterations() * faceCount(level));
+}
+
+void applyChannelVisitor(State& state) {
+	const unsigned int level = levelOf(state, 0);
+	Icosphere& icosphere = sharedIcosphere(FaceStorage::Flat, level);
+	FaceChannel<float>& channel = *icosphere.getChannels().add<float>("bench", 1.0f);
+	SumVisitor visitor;
+	while (state.keepRunning()) {
+		icosphere.applyVisitor(visitor, channel);
+	}
+	lillugsi::planet::bench::doNotOptimize(visitor.sum);
+	state.setItemsProcessed(state.getIterations() * faceCount(level));
+}
+
+void forEachFace(State& state) {
+	const unsigned int level = levelOf(state, 0);
+	const Icosphere& icosphere = sharedIcosphere(FaceStorage::Flat, level);
+	double sum = 0.0;
+	while (state.keepRunning()) {
+		for (unsigned int depth = 0; depth <= level; ++depth) {
+			icosphere.forEachFace(depth, [&sum, &icosphere](const FaceId id) { sum += icosphere.getFaceData(id); });
+		}
+	}
+	lillugsi::planet::bench::doNotOptimize(sum);
+	state.setItemsProcessed(state.getIterations() * faceCount(level));
+}
+
+/// Writes the leaf level to a temporary file, the argument is the MeshFormat
+void exportMesh(State& state) {
+	const auto format = static_cast<MeshFormat>(state.getArgument(0));
+	const unsigned int level = levelOf(state, 1);
+	const Icosphere& icosphere = sharedIcosphere(FaceStorage::Flat, level);
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "icosphere_bench.mesh";
+	ExportOptions options;
+	options.format = format;
+	while (state.keepRunning()) {
+		if (!MeshExporter::write(icosphere, path.string(), options)) {
+			state.skipWithError("could not write " + path.string());
+			break;
+		}
+	}
+	std::error_code error;
+	const auto bytes = static_cast<std::int64_t>(std::filesystem::file_size(path, error));
+	std::filesystem::remove(path, error);
+	state.setBytesProcessed(state.getIterations() * bytes);
+	state.setItemsProcessed(state.getIterations() * static_cast<std::int64_t>(faceid::levelFaceCount(level)));
+}
+
+/// All levels in the versioned sphere file format
+void saveSphereFile(State& state) {
+	const unsigned int level = levelOf(state, 0);
+	const Icosphere& icosphere = sharedIcosphere(FaceStorage::Flat, level);
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "icosphere_bench.sphere";
+	while (state.keepRunning()) {
+		if (!SphereFile::save(icosphere, path.string())) {
+			state.skipWithError("could not write " + path.string());
+			break;
+		}
+	}
+	std::error_code error;
+	const auto bytes = static_cast<std::int64_t>(std::filesystem::file_size(path, error));
+	std::filesystem::remove(path, error);
+	state.setBytesProcessed(state.getIterations() * bytes);
+	state.setItemsProcessed(state.getIterations() * faceCount(level));
+}
+
+/// Maps a sphere file written outside the timed region, touching the header only
+void openSphereFile(State& state) {
+	const unsigned int level = levelOf(state, 0);
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "icosphere_bench.sphere";
+	if (!SphereFile::save(sharedIcosphere(FaceStorage::Flat, level), path.string())) {
+		state.skipWithError("could not write " + path.string());
+		return;
+	}
+	while (state.keepRunning()) {
+		const std::unique_ptr<SphereFile> file = SphereFile::open(path.string());
+		if (!file) {
+			state.skipWithError("could not open " + path.string());
+			break;
+		}
+		lillugsi::planet::bench::doNotOptimize(file->getLevelCount());
+	}
+	std::error_code error;
+	std::filesystem::remove(path, error);
+	state.setItemsProcessed(state.getIterations() * faceCount(level));
+}
+
+/// Open plus Icosphere::load into a flat sphere, the alternative to subdivide/1/level
+void loadSphereFile(State& state) {
+	const unsigned int level = levelOf(state, 0);
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "icosphere_bench.sphere";
+	if (!SphereFile::save(sharedIcosphere(FaceStorage::Flat, level), path.string())) {
+		state.skipWithError("could not write " + path.string());
+		return;
+	}
+	std::int64_t bytes = 0;
+	while (state.keepRunning()) {
+		state.pauseTiming();
+		auto icosphere = std::make_unique<Icosphere>(FaceStorage::Flat);
+		state.resumeTiming();
+		const std::unique_ptr<SphereFile> file = SphereFile::open(path.string());
+		if (!file || !icosphere->load(*file)) {
+			state.skipWithError("could not load " + path.string());
+			break;
+		}
+		bytes = static_cast<std::int64_t>(file->getHeader().fileSize);
+		state.pauseTiming();
+		icosphere.reset();
+		state.resumeTiming();
+	}
+	std::error_code error;
+	std::filesystem::remove(path, error);
+	state.setBytesProcessed(state.getIterations() * bytes);
+	state.setItemsProcessed(state.getIterations() * faceCount(level));
+}
+
+std::vector<std::vector<std::int64_t>> levels(const unsigned int first, const unsigned int last,
+	const unsigned int step = 1) {
+	std::vector<std::vector<std::int64_t>> result;
+	for (unsigned int level = first; level <= last; level += step) {
+		result.push_back({level});
+	}
+	return result;
+}
+
+/// Prefixes every argument set with the given values
+std::vector<std::vector<std::int64_t>> prefixed(const std::vector<std::int64_t>& values,
+	const std::vector<std::vector<std::int64_t>>& argumentSets) {
+	std::vector<std::vector<std::int64_t>> result;
+	for (const std::int64_t value : values) {
+		for (const std::vector<std::int64_t>& arguments : argumentSets) {
+			result.push_back({value});
+			result.back().insert(result.back().end(), arguments.begin(), arguments.end());
+		}
+	}
+	return result;
+}
+
+/// Runs that share a sphere are registered next to each other, so it is built once
+void registerAll() {
+	using lillugsi::planet::bench::registerBenchmark;
+	registerBenchmark("subdivide", subdivide, prefixed({0}, levels(0, MaxTreeLevel)));
+	registerBenchmark("subdivide", subdivide, prefixed({1}, levels(0, MaxLevel)));
+	for (const unsigned int level : {4u, 6u, 8u}) {
+		const std::vector<std::vector<std::int64_t>> single = {{level}};
+		registerBenchmark("neighborSetup", neighborSetup, prefixed({0}, single));
+		registerBenchmark("getFaceAtPoint", getFaceAtPoint, prefixed({0}, prefixed({0, 1}, single)));
+		registerBenchmark("applyVisitor", applyVisitor, prefixed({0}, single));
+	}
+	for (const unsigned int level : {4u, 6u, 8u, 10u}) {
+		const std::vector<std::vector<std::int64_t>> single = {{level}};
+		registerBenchmark("neighborSetup", neighborSetup, prefixed({1}, single));
+		registerBenchmark("getFaceAtPoint", getFaceAtPoint, prefixed({1}, prefixed({0, 1}, single)));
+		registerBenchmark("applyVisitor", applyVisitor, prefixed({1}, single));
+		registerBenchmark("applyChannelVisitor", applyChannelVisitor, single);
+		registerBenchmark("forEachFace", forEachFace, single);
+	}
+	for (const unsigned int level : {4u, 6u, 8u}) {
+		const std::vector<std::vector<std::int64_t>> single = {{level}};
+		registerBenchmark("export", exportMesh, prefixed({static_cast<std::int64_t>(MeshFormat::Obj),
+			static_cast<std::int64_t>(MeshFormat::Ply), static_cast<std::int64_t>(MeshFormat::BinaryStl)}, single));
+		registerBenchmark("saveSphereFile", saveSphereFile, single);
+	}
+	for (const unsigned int level : {4u, 6u, 8u, 10u}) {
+		const std::vector<std::vector<std::int64_t>> single = {{level}};
+		registerBenchmark("openSphereFile", openSphereFile, single);
+		registerBenchmark("loadSphereFile", loadSphereFile, single);
+	}
+}
+} /// namespace
+
+int main(int argc, char** argv) {
+	registerAll();
+	return lillugsi::planet::bench::runBenchmarks(argc, argv);
+}
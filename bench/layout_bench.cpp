@@ -0,0 +1,233 @@
+/// Compares the stored face and vertex order of a level with the space-filling
+/// curve layout of MeshLayout on two memory bound passes:
+///   - neighbor averaging: every face reads its own value and those of its three
+///     edge neighbors from a per-face array,
+///   - vertex gather: every face reads its three corners to compute its centroid.
+/// Reports the time per pass, the misses of simulated L1 and L2 caches (after a
+/// warm-up pass) and, where the kernel allows it, hardware cache misses from
+/// perf_event_open.
+/// Usage: icosphere_layout_bench [level] [iterations], default 8 10
+
+#include "icosphere.h"
+#include "meshlayout.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace lillugsi::planet;
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+/// Hardware cache misses of the calling thread, -1 if perf events are not available
+class CacheMissCounter {
+public:
+	CacheMissCounter() {
+#if defined(__linux__)
+		perf_event_attr attributes{};
+		attributes.type = PERF_TYPE_HARDWARE;
+		attributes.size = sizeof(attributes);
+		attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+		attributes.disabled = 1;
+		attributes.exclude_kernel = 1;
+		attributes.exclude_hv = 1;
+		this->descriptor = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+#endif
+	}
+	~CacheMissCounter() {
+#if defined(__linux__)
+		if (this->descriptor >= 0)
+			close(this->descriptor);
+#endif
+	}
+
+	void start() {
+#if defined(__linux__)
+		if (this->descriptor >= 0) {
+			ioctl(this->descriptor, PERF_EVENT_IOC_RESET, 0);
+			ioctl(this->descriptor, PERF_EVENT_IOC_ENABLE, 0);
+		}
+#endif
+	}
+	[[nodiscard]] long long stop() {
+#if defined(__linux__)
+		if (this->descriptor >= 0) {
+			ioctl(this->descriptor, PERF_EVENT_IOC_DISABLE, 0);
+			long long count = 0;
+			if (read(this->descriptor, &count, sizeof(count)) == sizeof(count))
+				return count;
+		}
+#endif
+		return -1;
+	}
+
+private:
+	int descriptor{-1};
+};
+
+/// Set associative cache with LRU replacement and 64 byte lines
+class SimulatedCache {
+public:
+	SimulatedCache(const std::size_t bytes, const std::size_t ways)
+	: ways(ways), sets(bytes / 64 / ways), tags(bytes / 64, ~std::uintptr_t{0}) {}
+
+	void access(const void* address) {
+		const auto line = reinterpret_cast<std::uintptr_t>(address) / 64;
+		std::uintptr_t* set = &this->tags[(line % this->sets) * this->ways];
+		/// Most recently used first
+		std::size_t way = 0;
+		while (way < this->ways && set[way] != line) {
+			++way;
+		}
+		if (way == this->ways) {
+			++this->misses;
+			way = this->ways - 1;
+		}
+		std::rotate(set, set + way, set + way + 1);
+		set[0] = line;
+	}
+
+	std::size_t misses{0};
+
+private:
+	std::size_t ways;
+	std::size_t sets;
+	std::vector<std::uintptr_t> tags;
+};
+
+struct PassResult {
+	double milliseconds;
+	long long hardwareMisses;
+	std::size_t level1Misses; /// Simulated 32 KiB 8-way
+	std::size_t level2Misses; /// Simulated 1 MiB 16-way
+};
+
+/// One averaging pass over the layout, with an optional cache to feed every access to
+template <typename Cache>
+void averageNeighbors(const MeshLayout& layout, const std::vector<float>& in, std::vector<float>& out, Cache* cache) {
+	const auto neighbors = layout.getNeighbors();
+	for (std::size_t face = 0; face < neighbors.size(); ++face) {
+		const std::array<unsigned int, 3>& links = neighbors[face];
+		if constexpr (!std::is_same_v<Cache, std::nullptr_t>) {
+			cache->access(&neighbors[face]);
+			cache->access(&in[face]);
+			for (const unsigned int link : links) {
+				cache->access(&in[link]);
+			}
+			cache->access(&out[face]);
+		}
+		out[face] = (in[face] + in[links[0]] + in[links[1]] + in[links[2]]) * 0.25f;
+	}
+}
+
+template <typename Cache>
+void gatherCentroids(const MeshLayout& layout, std::vector<float>& out, Cache* cache) {
+	const auto indices = layout.getIndices();
+	const VertexBuffer& vertices = layout.getVertices();
+	const std::span<const float> x = vertices.getX();
+	const std::span<const float> y = vertices.getY();
+	const std::span<const float> z = vertices.getZ();
+	for (std::size_t face = 0; face < out.size(); ++face) {
+		float sum = 0.0f;
+		for (unsigned int corner = 0; corner < 3; ++corner) {
+			const unsigned int vertex = indices[3 * face + corner];
+			if constexpr (!std::is_same_v<Cache, std::nullptr_t>) {
+				cache->access(&indices[3 * face + corner]);
+				cache->access(&x[vertex]);
+				cache->access(&y[vertex]);
+				cache->access(&z[vertex]);
+			}
+			sum += x[vertex] + y[vertex] + z[vertex];
+		}
+		out[face] = sum;
+	}
+}
+
+template <typename Pass>
+PassResult measure(const int iterations, Pass&& pass) {
+	PassResult result{};
+	CacheMissCounter counter;
+	std::nullptr_t* const noCache = nullptr;
+	pass(noCache); /// Warm up
+	counter.start();
+	const auto start = Clock::now();
+	for (int iteration = 0; iteration < iterations; ++iteration) {
+		pass(noCache);
+	}
+	result.milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / iterations;
+	result.hardwareMisses = counter.stop();
+	if (result.hardwareMisses >= 0)
+		result.hardwareMisses /= iterations;
+
+	/// Caches sized like a typical L1 and L2, warmed up by one pass
+	const auto simulate = [&pass](const std::size_t bytes, const std::size_t ways) {
+		SimulatedCache cache(bytes, ways);
+		pass(&cache);
+		cache.misses = 0;
+		pass(&cache);
+		return cache.misses;
+	};
+	result.level1Misses = simulate(32 << 10, 8);
+	result.level2Misses = simulate(1 << 20, 16);
+	return result;
+}
+
+void print(const char* pass, const char* order, const PassResult& result, const std::size_t faces) {
+	const auto perFace = [faces](const double count) { return count / static_cast<double>(faces); };
+	std::printf("%-18s %-8s %9.2f ms   misses/face: L1 %6.3f  L2 %6.3f", pass, order, result.milliseconds,
+		perFace(static_cast<double>(result.level1Misses)), perFace(static_cast<double>(result.level2Misses)));
+	if (result.hardwareMisses >= 0)
+		std::printf("  hw %6.3f", perFace(static_cast<double>(result.hardwareMisses)));
+	else
+		std::printf("  (no hw counters)");
+	std::printf("\n");
+}
+} /// namespace
+
+int main(int argc, char** argv) {
+	const int level = argc > 1 ? std::atoi(argv[1]) : 8;
+	const int iterations = argc > 2 ? std::max(1, std::atoi(argv[2])) : 10;
+
+	Icosphere icosphere(FaceStorage::Flat);
+	icosphere.subdivide(level, 0);
+	std::printf("level %d, %zu faces, %zu vertices\n", level,
+		icosphere.getLeafIndices().size() / 3, icosphere.getLeafVertices().size());
+
+	for (const FaceOrder order : {FaceOrder::FaceId, FaceOrder::Curve}) {
+		const auto start = Clock::now();
+		const MeshLayout layout(icosphere, static_cast<unsigned int>(level), order);
+		const double buildMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		const char* name = order == FaceOrder::FaceId ? "FaceId" : "curve";
+		const std::size_t faces = layout.getFaceCount();
+
+		std::vector<float> in(faces);
+		std::vector<float> out(faces);
+		for (std::size_t face = 0; face < faces; ++face) {
+			in[face] = static_cast<float>(layout.getFaceId(face) % 97);
+		}
+		print("neighbor average", name, measure(iterations, [&](auto* cache) {
+			averageNeighbors(layout, in, out, cache);
+			std::swap(in, out);
+		}), faces);
+		print("vertex gather", name, measure(iterations, [&](auto* cache) {
+			gatherCentroids(layout, out, cache);
+		}), faces);
+		std::printf("%-18s %-8s %9.2f ms\n", "layout build", name, buildMilliseconds);
+	}
+	return 0;
+}
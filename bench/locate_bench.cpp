@@ -0,0 +1,80 @@
+/// Point location throughput: one getFaceIdAtPoint call per point against the
+/// batched locatePoints, on one thread and on all hardware threads.
+/// The batched results are checked against the scalar ones.
+/// Usage: icosphere_locate_bench [level] [points], default 8 1000000
+
+#include "icosphere.h"
+#include "parallel.h"
+#include "simd.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace lillugsi::planet;
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+/// Uniform on the sphere: normalized Gaussian samples
+std::vector<Vector3> randomPoints(std::size_t count) {
+	std::mt19937 generator(42);
+	std::normal_distribution<float> distribution;
+	std::vector<Vector3> points(count);
+	for (Vector3& point : points) {
+		point = Vector3(distribution(generator), distribution(generator), distribution(generator));
+		point.normalize();
+	}
+	return points;
+}
+
+template <typename Function>
+double seconds(Function&& function) {
+	const auto start = Clock::now();
+	function();
+	const std::chrono::duration<double> elapsed = Clock::now() - start;
+	return elapsed.count();
+}
+} /// namespace
+
+int main(int argc, char* argv[]) {
+	const int level = argc > 1 ? std::atoi(argv[1]) : 8;
+	const std::size_t count = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000000;
+
+	Icosphere icosphere(FaceStorage::Flat);
+	icosphere.subdivide(level, 0);
+	const std::vector<Vector3> points = randomPoints(count);
+
+	std::vector<FaceId> scalar(count);
+	const double scalarSeconds = seconds([&]() {
+		for (std::size_t i = 0; i < count; ++i) {
+			scalar[i] = icosphere.getFaceIdAtPoint(points[i]);
+		}
+	});
+
+	const unsigned int threadCount = resolveThreadCount(0);
+	std::vector<FaceId> batched(count);
+	const double batchedSeconds = seconds([&]() { icosphere.locatePoints(points, batched, level, 1); });
+	if (batched != scalar) {
+		std::printf("batched locate differs from scalar locate\n");
+		return 1;
+	}
+	std::vector<FaceId> parallel(count);
+	const double parallelSeconds = seconds([&]() { icosphere.locatePoints(points, parallel, level, threadCount); });
+	if (parallel != scalar) {
+		std::printf("parallel locate differs from scalar locate\n");
+		return 1;
+	}
+
+	const auto pointsPerSecond = [count](double elapsed) { return static_cast<double>(count) / elapsed; };
+	std::printf("level %d, %zu points, %s with %u lanes\n", level, count, simd::InstructionSet, simd::FloatBatch::Width);
+	std::printf("%-22s %12s %8s\n", "", "points/s", "speedup");
+	std::printf("%-22s %12.3g %7.1fx\n", "scalar", pointsPerSecond(scalarSeconds), 1.0);
+	std::printf("%-22s %12.3g %7.1fx\n", "batched, 1 thread", pointsPerSecond(batchedSeconds),
+		scalarSeconds / batchedSeconds);
+	std::printf("batched, %2u threads   %12.3g %7.1fx\n", threadCount, pointsPerSecond(parallelSeconds),
+		scalarSeconds / parallelSeconds);
+	return 0;
+}
@@ -0,0 +1,146 @@
+/// Compares the std::map edge-to-midpoint cache that Icosphere used to have
+/// with the analytic VertexNumbering, by running the midpoint part of a full
+/// depth-first subdivision for each level.
+/// Usage: icosphere_midpoint_bench [minLevel] [maxLevel], default 6 10
+
+#include "icosphere.h"
+#include "vertexnumbering.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <vector>
+
+using namespace lillugsi::planet;
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+	double milliseconds;
+	std::size_t vertexCount;
+};
+
+/// Reference: the cache as it was before, without the logging
+class MapMidpoints {
+public:
+	explicit MapMidpoints(std::vector<Vector3> vertices) : vertices(std::move(vertices)) {}
+
+	unsigned int getOrCreate(unsigned int index1, unsigned int index2) {
+		const std::pair<unsigned int, unsigned int> key(std::min(index1, index2), std::max(index1, index2));
+		const auto it = this->cache.find(key);
+		if (it != this->cache.end())
+			return it->second;
+
+		Vector3 midpoint = (this->vertices[index1] + this->vertices[index2]) * 0.5f;
+		midpoint.normalize();
+		this->vertices.push_back(midpoint);
+		const auto index = static_cast<unsigned int>(this->vertices.size() - 1);
+		this->cache[key] = index;
+		return index;
+	}
+
+	void subdivide(const std::array<unsigned int, 3>& face, unsigned int level) {
+		if (level == 0)
+			return;
+		const unsigned int mid1 = this->getOrCreate(face[0], face[1]);
+		const unsigned int mid2 = this->getOrCreate(face[1], face[2]);
+		const unsigned int mid3 = this->getOrCreate(face[2], face[0]);
+		this->subdivide({mid3, mid1, face[0]}, level - 1);
+		this->subdivide({mid2, face[1], mid1}, level - 1);
+		this->subdivide({face[2], mid2, mid3}, level - 1);
+		this->subdivide({mid3, mid2, mid1}, level - 1);
+	}
+
+	std::vector<Vector3> vertices;
+	std::map<std::pair<unsigned int, unsigned int>, unsigned int> cache;
+};
+
+class AnalyticMidpoints {
+public:
+	AnalyticMidpoints(const VertexNumbering& numbering, std::vector<Vector3> vertices, unsigned int levels)
+	: numbering(numbering), vertices(std::move(vertices)) {
+		this->vertices.resize(VertexNumbering::vertexCount(levels));
+	}
+
+	unsigned int create(FaceId baseFace, unsigned int level, LatticePoint point,
+		unsigned int index1, unsigned int index2) {
+		const unsigned int index = this->numbering.vertexIndex(baseFace, level, point);
+		Vector3 midpoint = (this->vertices[index1] + this->vertices[index2]) * 0.5f;
+		midpoint.normalize();
+		this->vertices[index] = midpoint;
+		return index;
+	}
+
+	void subdivide(FaceId baseFace, const std::array<unsigned int, 3>& face,
+		const std::array<LatticePoint, 3>& corners, unsigned int level, unsigned int targetLevel) {
+		if (level == targetLevel)
+			return;
+		const unsigned int mid1 = this->create(baseFace, level + 1, corners[0] + corners[1], face[0], face[1]);
+		const unsigned int mid2 = this->create(baseFace, level + 1, corners[1] + corners[2], face[1], face[2]);
+		const unsigned int mid3 = this->create(baseFace, level + 1, corners[2] + corners[0], face[2], face[0]);
+		const std::array<std::array<unsigned int, 3>, 4> children = {{
+			{mid3, mid1, face[0]}, {mid2, face[1], mid1}, {face[2], mid2, mid3}, {mid3, mid2, mid1}}};
+		for (unsigned int slot = 0; slot < 4; ++slot) {
+			this->subdivide(baseFace, children[slot], VertexNumbering::childCorners(corners, slot),
+				level + 1, targetLevel);
+		}
+	}
+
+	const VertexNumbering& numbering;
+	std::vector<Vector3> vertices;
+};
+
+Result runMap(const std::vector<Vector3>& baseVertices, const FaceStore& baseFaces, unsigned int levels) {
+	const auto start = Clock::now();
+	MapMidpoints midpoints(baseVertices);
+	for (FaceId baseFace = 0; baseFace < baseFaces.getLevelEnd(0); ++baseFace) {
+		midpoints.subdivide(baseFaces[baseFace].vertexIndices, levels);
+	}
+	const std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+	return {elapsed.count(), midpoints.vertices.size()};
+}
+
+Result runAnalytic(const std::vector<Vector3>& baseVertices, const FaceStore& baseFaces, unsigned int levels) {
+	std::array<std::array<unsigned int, 3>, 20> baseFaceVertices{};
+	for (FaceId baseFace = 0; baseFace < baseFaceVertices.size(); ++baseFace) {
+		baseFaceVertices[baseFace] = baseFaces[baseFace].vertexIndices;
+	}
+	const VertexNumbering numbering(baseFaceVertices);
+
+	const auto start = Clock::now();
+	AnalyticMidpoints midpoints(numbering, baseVertices, levels);
+	for (FaceId baseFace = 0; baseFace < baseFaces.getLevelEnd(0); ++baseFace) {
+		midpoints.subdivide(baseFace, baseFaces[baseFace].vertexIndices, VertexNumbering::baseCorners(), 0, levels);
+	}
+	const std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+	return {elapsed.count(), midpoints.vertices.size()};
+}
+} /// namespace
+
+int main(int argc, char* argv[]) {
+	const unsigned int minLevel = argc > 1 ? static_cast<unsigned int>(std::atoi(argv[1])) : 6;
+	const unsigned int maxLevel = argc > 2 ? static_cast<unsigned int>(std::atoi(argv[2])) : 10;
+
+	const Icosphere icosphere(FaceStorage::Flat);
+	const std::vector<Vector3> baseVertices = icosphere.getVertices();
+
+	std::printf("%5s %10s %12s %12s %12s %8s\n", "level", "vertices", "map ms", "analytic ms", "lookups/s", "speedup");
+	for (unsigned int level = minLevel; level <= maxLevel; ++level) {
+		const Result map = runMap(baseVertices, icosphere.getFaces(), level);
+		const Result analytic = runAnalytic(baseVertices, icosphere.getFaces(), level);
+		if (map.vertexCount != analytic.vertexCount) {
+			std::printf("level %u: vertex count differs (%zu vs %zu)\n", level, map.vertexCount, analytic.vertexCount);
+			return 1;
+		}
+
+		/// Three midpoint lookups per split face
+		const double lookups = 3.0 * 20.0 * static_cast<double>((std::uint64_t{1} << (2 * level)) - 1) / 3.0;
+		std::printf("%5u %10zu %12.1f %12.1f %12.3g %7.1fx\n", level, analytic.vertexCount,
+			map.milliseconds, analytic.milliseconds, lookups / (analytic.milliseconds / 1000.0),
+			map.milliseconds / analytic.milliseconds);
+	}
+	return 0;
+}
@@ -0,0 +1,377 @@
+#include "adaptiveicosphere.h"
+#include "icosphere.h"
+#include "log.h"
+
+#include <algorithm> /// For std::min, std::sort and std::unique
+#include <bit> /// For std::popcount and std::countr_zero
+
+namespace lillugsi::planet {
+namespace {
+/// Every split reverses the stored order, so faces of even levels are stored clockwise
+bool storedClockwise(const unsigned int level) {
+	return level % 2 == 0;
+}
+
+/// Sorts and deduplicates changed indices into ranges and empties the list
+std::vector<AdaptiveIcosphere::Range> takeRanges(std::vector<unsigned int>& changed) {
+	std::sort(changed.begin(), changed.end());
+	changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+	std::vector<AdaptiveIcosphere::Range> ranges;
+	for (const unsigned int index : changed) {
+		if (!ranges.empty() && ranges.back().end == index)
+			++ranges.back().end;
+		else
+			ranges.push_back({index, index + 1});
+	}
+	changed.clear();
+	return ranges;
+}
+} /// namespace
+
+AdaptiveIcosphere::AdaptiveIcosphere() {
+	this->reset(0);
+}
+
+void AdaptiveIcosphere::reset(const unsigned int maxLevel) {
+	if (maxLevel > faceid::MaxLevel)
+		LOG_WARN("AdaptiveIcosphere: maxLevel ", maxLevel, " is clamped to ", faceid::MaxLevel);
+	this->maxLevel = std::min(maxLevel, faceid::MaxLevel);
+
+	/// The icosahedron and its numbering come from the uniform sphere, so both agree on every id
+	const Icosphere icosahedron(FaceStorage::Flat);
+	std::array<std::array<unsigned int, 3>, 20> baseFaceVertices{};
+	for (FaceId baseFace = 0; baseFace < baseFaceVertices.size(); ++baseFace) {
+		baseFaceVertices[baseFace] = icosahedron.getFaces()[baseFace].vertexIndices;
+	}
+	this->vertexNumbering = VertexNumbering(baseFaceVertices);
+	this->lattice = FaceLattice(baseFaceVertices);
+
+	this->vertices = icosahedron.getVertexBuffer();
+	this->vertexSlots.clear();
+	this->vertexReferences.assign(this->vertices.size(), 1);
+	this->freeVertices.clear();
+	this->changedVertices.clear();
+	for (unsigned int vertex = 0; vertex < this->vertices.size(); ++vertex) {
+		this->vertexSlots.emplace(vertex, vertex);
+		this->changedVertices.push_back(vertex);
+	}
+
+	this->splitFaces.clear();
+	this->leafSlots.clear();
+	this->slotFaces.clear();
+	this->freeSlots.clear();
+	this->indices.clear();
+	this->queuedSplits.clear();
+	this->changedLeaves.clear();
+	this->changedSlots.clear();
+	for (FaceId id = 0; id < 20; ++id) {
+		this->addLeaf(id);
+	}
+	this->writeChangedLeaves();
+}
+
+bool AdaptiveIcosphere::contains(const FaceId id) const {
+	const FaceId parent = faceid::parentOf(id);
+	return parent == InvalidFaceId ? id < 20 : this->splitFaces.contains(parent);
+}
+
+bool AdaptiveIcosphere::isLeaf(const FaceId id) const {
+	return this->leafSlots.contains(id);
+}
+
+unsigned int AdaptiveIcosphere::vertexOf(const FaceId baseFace, const unsigned int level,
+	const LatticePoint& point) const {
+	return this->vertexSlots.at(this->vertexNumbering.vertexIndex(baseFace, level, point));
+}
+
+std::array<Vector3, 3> AdaptiveIcosphere::getCorners(const FaceId id) const {
+	const FaceId baseFace = faceid::baseFaceOf(id);
+	const unsigned int level = faceid::levelOf(id);
+	const std::array<LatticePoint, 3> corners = VertexNumbering::cornersOf(id);
+	std::array<Vector3, 3> result{};
+	for (unsigned int corner = 0; corner < 3; ++corner) {
+		result[corner] = this->vertices[this->vertexOf(baseFace, level, corners[corner])];
+	}
+	if (storedClockwise(level))
+		std::swap(result[1], result[2]);
+	return result;
+}
+
+std::array<FaceId, 2> AdaptiveIcosphere::getNeighbors(const FaceId leaf, const unsigned int edge) const {
+	FaceId neighbor = this->lattice.neighborOf(leaf, edge);
+	if (!this->contains(neighbor)) {
+		/// Coarser: the restriction allows only one level, but walk up to be safe
+		while (!this->contains(neighbor)) {
+			neighbor = faceid::parentOf(neighbor);
+		}
+		return {neighbor, InvalidFaceId};
+	}
+	if (!this->isSplit(neighbor))
+		return {neighbor, InvalidFaceId};
+
+	/// Finer: the two corner children of the neighbor that touch this leaf
+	std::array<FaceId, 2> result = {InvalidFaceId, InvalidFaceId};
+	unsigned int found = 0;
+	for (unsigned int slot = 0; slot < 3 && found < 2; ++slot) {
+		const FaceId child = faceid::childOf(neighbor, slot);
+		for (unsigned int childEdge = 0; childEdge < 3; ++childEdge) {
+			if (faceid::parentOf(this->lattice.neighborOf(child, childEdge)) == leaf) {
+				result[found++] = child;
+				break;
+			}
+		}
+	}
+	return result;
+}
+
+unsigned int AdaptiveIcosphere::acquireMidpoint(const FaceId baseFace, const unsigned int level,
+	const std::array<LatticePoint, 3>& corners, const unsigned int edge) {
+	const LatticePoint& from = corners[edge];
+	const LatticePoint& to = corners[(edge + 1) % 3];
+	const unsigned int key = this->vertexNumbering.vertexIndex(baseFace, level + 1, from + to);
+	const auto [it, inserted] = this->vertexSlots.try_emplace(key, 0);
+	if (!inserted) {
+		++this->vertexReferences[it->second];
+		return it->second;
+	}
+	/// Same expression as the uniform subdivision, so the positions match bit for bit
+	const Vector3 first = this->vertices[this->vertexOf(baseFace, level, from)];
+	const Vector3 second = this->vertices[this->vertexOf(baseFace, level, to)];
+	const Vector3 position = ((first + second) * 0.5f).normalized();
+	if (this->freeVertices.empty()) {
+		it->second = static_cast<unsigned int>(this->vertices.size());
+		this->vertices.add(position);
+		this->vertexReferences.push_back(1);
+	} else {
+		it->second = this->freeVertices.back();
+		this->freeVertices.pop_back();
+		this->vertices.set(it->second, position);
+		this->vertexReferences[it->second] = 1;
+	}
+	this->changedVertices.push_back(it->second);
+	return it->second;
+}
+
+void AdaptiveIcosphere::releaseMidpoint(const FaceId baseFace, const unsigned int level,
+	const std::array<LatticePoint, 3>& corners, const unsigned int edge) {
+	const LatticePoint midpoint = corners[edge] + corners[(edge + 1) % 3];
+	const auto it = this->vertexSlots.find(this->vertexNumbering.vertexIndex(baseFace, level + 1, midpoint));
+	if (--this->vertexReferences[it->second] == 0) {
+		this->freeVertices.push_back(it->second);
+		this->vertexSlots.erase(it);
+	}
+}
+
+void AdaptiveIcosphere::addLeaf(const FaceId id) {
+	unsigned int slot = 0;
+	if (this->freeSlots.empty()) {
+		slot = static_cast<unsigned int>(this->slotFaces.size());
+		this->slotFaces.push_back(id);
+		this->indices.resize(this->indices.size() + SlotSize, 0);
+	} else {
+		slot = this->freeSlots.back();
+		this->freeSlots.pop_back();
+		this->slotFaces[slot] = id;
+	}
+	this->leafSlots.emplace(id, slot);
+	this->changedLeaves.push_back(id);
+}
+
+void AdaptiveIcosphere::removeLeaf(const FaceId id) {
+	const auto it = this->leafSlots.find(id);
+	const unsigned int slot = it->second;
+	this->leafSlots.erase(it);
+	this->slotFaces[slot] = InvalidFaceId;
+	this->freeSlots.push_back(slot);
+	/// An unused slot draws nothing
+	std::fill_n(this->indices.begin() + SlotSize * slot, SlotSize, 0);
+	this->changedSlots.push_back(slot);
+}
+
+void AdaptiveIcosphere::splitFace(const FaceId id) {
+	const unsigned int level = faceid::levelOf(id);
+	if (level >= faceid::MaxLevel || !this->isLeaf(id))
+		return;
+
+	const FaceId baseFace = faceid::baseFaceOf(id);
+	const std::array<LatticePoint, 3> corners = VertexNumbering::cornersOf(id);
+	for (unsigned int edge = 0; edge < 3; ++edge) {
+		this->acquireMidpoint(baseFace, level, corners, edge);
+	}
+
+	this->removeLeaf(id);
+	this->splitFaces.insert(id);
+	for (unsigned int slot = 0; slot < 4; ++slot) {
+		this->addLeaf(faceid::childOf(id, slot));
+	}
+	/// Leaves next to the face now have a finer neighbor
+	for (unsigned int edge = 0; edge < 3; ++edge) {
+		const FaceId neighbor = this->lattice.neighborOf(baseFace, level, corners, edge);
+		if (this->isLeaf(neighbor))
+			this->changedLeaves.push_back(neighbor);
+	}
+	this->queuedSplits.push_back(id);
+}
+
+bool AdaptiveIcosphere::canMerge(const FaceId id) const {
+	for (unsigned int slot = 0; slot < 4; ++slot) {
+		if (this->isSplit(faceid::childOf(id, slot)))
+			return false;
+	}
+	/// A child with a finer neighbor outside the face would end up two levels apart from it
+	for (unsigned int slot = 0; slot < 3; ++slot) {
+		const FaceId child = faceid::childOf(id, slot);
+		for (unsigned int edge = 0; edge < 3; ++edge) {
+			const FaceId neighbor = this->lattice.neighborOf(child, edge);
+			if (faceid::parentOf(neighbor) != id && this->isSplit(neighbor))
+				return false;
+		}
+	}
+	return true;
+}
+
+void AdaptiveIcosphere::splitWithAncestors(const FaceId id) {
+	if (!this->contains(id))
+		this->splitWithAncestors(faceid::parentOf(id));
+	this->splitFace(id);
+}
+
+unsigned int AdaptiveIcosphere::finerEdges(const FaceId id, const std::array<LatticePoint, 3>& corners) const {
+	const FaceId baseFace = faceid::baseFaceOf(id);
+	const unsigned int level = faceid::levelOf(id);
+	unsigned int mask = 0;
+	for (unsigned int edge = 0; edge < 3; ++edge) {
+		if (this->isSplit(this->lattice.neighborOf(baseFace, level, corners, edge)))
+			mask |= 1u << edge;
+	}
+	return mask;
+}
+
+void AdaptiveIcosphere::restoreRestriction() {
+	while (!this->queuedSplits.empty()) {
+		const FaceId id = this->queuedSplits.back();
+		this->queuedSplits.pop_back();
+
+		/// A missing neighbor means a leaf two levels coarser than the children
+		for (unsigned int edge = 0; edge < 3; ++edge) {
+			const FaceId neighbor = this->lattice.neighborOf(id, edge);
+			if (!this->contains(neighbor))
+				this->splitWithAncestors(faceid::parentOf(neighbor));
+		}
+	}
+}
+
+bool AdaptiveIcosphere::refine(const FaceId leaf) {
+	if (!this->isLeaf(leaf) || faceid::levelOf(leaf) >= this->maxLevel)
+		return false;
+	this->splitFace(leaf);
+	this->restoreRestriction();
+	this->writeChangedLeaves();
+	return true;
+}
+
+bool AdaptiveIcosphere::coarsen(const FaceId face) {
+	if (!this->isSplit(face) || !this->canMerge(face))
+		return false;
+
+	const std::array<LatticePoint, 3> corners = VertexNumbering::cornersOf(face);
+	const FaceId baseFace = faceid::baseFaceOf(face);
+	const unsigned int level = faceid::levelOf(face);
+	for (unsigned int slot = 0; slot < 4; ++slot) {
+		this->removeLeaf(faceid::childOf(face, slot));
+	}
+	this->splitFaces.erase(face);
+	this->addLeaf(face);
+	for (unsigned int edge = 0; edge < 3; ++edge) {
+		this->releaseMidpoint(baseFace, level, corners, edge);
+		/// Leaves next to the face lose their finer neighbor
+		const FaceId neighbor = this->lattice.neighborOf(baseFace, level, corners, edge);
+		if (this->isLeaf(neighbor))
+			this->changedLeaves.push_back(neighbor);
+	}
+	this->writeChangedLeaves();
+	return true;
+}
+
+std::vector<AdaptiveIcosphere::Range> AdaptiveIcosphere::takeChangedSlots() {
+	return takeRanges(this->changedSlots);
+}
+
+std::vector<AdaptiveIcosphere::Range> AdaptiveIcosphere::takeChangedVertices() {
+	return takeRanges(this->changedVertices);
+}
+
+void AdaptiveIcosphere::writeChangedLeaves() {
+	for (const FaceId id : this->changedLeaves) {
+		const auto it = this->leafSlots.find(id);
+		if (it != this->leafSlots.end())
+			this->writeLeaf(id, it->second);
+	}
+	this->changedLeaves.clear();
+}
+
+void AdaptiveIcosphere::writeLeaf(const FaceId id, const unsigned int slot) {
+	const FaceId baseFace = faceid::baseFaceOf(id);
+	const unsigned int level = faceid::levelOf(id);
+	const std::array<LatticePoint, 3> corners = VertexNumbering::cornersOf(id);
+	std::array<unsigned int, 3> vertex{};
+	for (unsigned int corner = 0; corner < 3; ++corner) {
+		vertex[corner] = this->vertexOf(baseFace, level, corners[corner]);
+	}
+
+	/// Triangles in stored order through the midpoints of the edges with a finer neighbor,
+	/// unused ones degenerate
+	const unsigned int finer = this->finerEdges(id, corners);
+	std::array<unsigned int, 3> midpoint{};
+	for (unsigned int edge = 0; edge < 3; ++edge) {
+		if (finer & (1u << edge))
+			midpoint[edge] = this->vertexOf(baseFace, level + 1, corners[edge] + corners[(edge + 1) % 3]);
+	}
+	std::array<unsigned int, SlotSize> triangles{};
+	triangles.fill(vertex[0]);
+	const auto setTriangle = [&triangles](const unsigned int triangle,
+		const unsigned int first, const unsigned int second, const unsigned int third) {
+		triangles[3 * triangle] = first;
+		triangles[3 * triangle + 1] = second;
+		triangles[3 * triangle + 2] = third;
+	};
+	switch (std::popcount(finer)) {
+	case 0:
+		setTriangle(0, vertex[0], vertex[1], vertex[2]);
+		break;
+	case 1: {
+		/// Fan from the opposite corner
+		const auto edge = static_cast<unsigned int>(std::countr_zero(finer));
+		const unsigned int next = (edge + 1) % 3;
+		const unsigned int opposite = (edge + 2) % 3;
+		setTriangle(0, vertex[edge], midpoint[edge], vertex[opposite]);
+		setTriangle(1, midpoint[edge], vertex[next], vertex[opposite]);
+		break;
+	}
+	case 2: {
+		/// Edges edge and next are finer: cut off the corner between them, then split the rest
+		const unsigned int edge = (static_cast<unsigned int>(std::countr_zero(~finer & 7u)) + 1) % 3;
+		const unsigned int next = (edge + 1) % 3;
+		const unsigned int opposite = (edge + 2) % 3;
+		setTriangle(0, midpoint[edge], vertex[next], midpoint[next]);
+		setTriangle(1, vertex[edge], midpoint[edge], midpoint[next]);
+		setTriangle(2, vertex[edge], midpoint[next], vertex[opposite]);
+		break;
+	}
+	default:
+		/// Like the four children
+		setTriangle(0, vertex[0], midpoint[0], midpoint[2]);
+		setTriangle(1, midpoint[0], vertex[1], midpoint[1]);
+		setTriangle(2, midpoint[2], midpoint[1], vertex[2]);
+		setTriangle(3, midpoint[0], midpoint[1], midpoint[2]);
+		break;
+	}
+	if (storedClockwise(level)) {
+		for (unsigned int triangle = 0; triangle < SlotSize; triangle += 3) {
+			std::swap(triangles[triangle + 1], triangles[triangle + 2]);
+		}
+	}
+	std::copy(triangles.begin(), triangles.end(), this->indices.begin() + SlotSize * slot);
+	this->changedSlots.push_back(slot);
+}
+} /// namespace lillugsi::planet
@@ -0,0 +1,181 @@
+#pragma once
+
+#include "faceid.h"
+#include "vector3.h"
+#include "vertexbuffer.h"
+#include "vertexnumbering.h"
+#include "facelattice.h"
+#include <array>
+#include <memory_resource>
+#include <span>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace lillugsi::planet {
+/// Sparse, adaptively refined icosphere.
+/// Faces use the FaceIds, lattice and vertex numbering of the uniform Icosphere,
+/// but only the faces that were split are stored, so memory follows the number
+/// of leaves instead of 20 * 4^maxLevel.
+///
+/// The refinement is kept restricted: leaves sharing an edge differ by at most
+/// one level. A leaf with finer neighbors is drawn as up to four triangles through
+/// the midpoints of those edges, so the leaf index buffer has no cracks
+/// (T-junctions) at level transitions.
+///
+/// Vertex positions are the same floats the uniform subdivision produces. Vertices
+/// and triangles are numbered compactly: every leaf owns a slot of four triangles in
+/// the index buffer, the ones it does not need are degenerate. All
+/// triangles are wound counterclockwise seen from outside.
+///
+/// refine() and coarsen() change single faces, for example around a moving
+/// viewpoint. Their cost depends on the number of faces they touch, not on the
+/// mesh size: vertices and slots never move, freed ones are reused, and only the
+/// slots of touched leaves are rewritten. takeChangedSlots() and
+/// takeChangedVertices() report what to upload since the last call.
+class AdaptiveIcosphere {
+public:
+	/// Indices per leaf slot, four triangles
+	static constexpr unsigned int SlotSize = 12;
+
+	/// Half-open range [begin, end) of slots or vertices
+	struct Range {
+		unsigned int begin;
+		unsigned int end;
+	};
+
+	AdaptiveIcosphere();
+
+	/// Rebuilds the mesh from the icosahedron: every face below maxLevel for which
+	/// predicate(id, corners) returns true is split, its children are tested in turn.
+	/// corners are the positions of the face, counterclockwise seen from outside.
+	/// Afterwards faces are split as needed to keep the refinement restricted.
+	template <typename Predicate>
+	void subdivide(Predicate&& predicate, unsigned int maxLevel);
+
+	/// Splits a leaf below maxLevel, plus the neighbors the restriction requires.
+	/// Returns false if the face is no leaf or already on maxLevel.
+	bool refine(FaceId leaf);
+	/// Merges the four children of a face back into it. Returns false if a child is
+	/// split or the merge would break the restriction, coarsen the finer faces first.
+	bool coarsen(FaceId face);
+
+	/// Slots and vertices written since the last call, sorted and merged into ranges.
+	/// Slots of removed leaves are reported too, they are rewritten as degenerate.
+	[[nodiscard]] std::vector<Range> takeChangedSlots();
+	[[nodiscard]] std::vector<Range> takeChangedVertices();
+
+	[[nodiscard]] unsigned int getMaxLevel() const { return this->maxLevel; }
+	[[nodiscard]] std::size_t getLeafCount() const { return this->leafSlots.size(); }
+	[[nodiscard]] std::size_t getSplitCount() const { return this->splitFaces.size(); }
+	/// Whether the face exists, which is whether its parent was split
+	[[nodiscard]] bool contains(FaceId id) const;
+	[[nodiscard]] bool isLeaf(FaceId id) const;
+	[[nodiscard]] bool isSplit(FaceId id) const { return this->splitFaces.contains(id); }
+
+	/// Corner positions of an existing face, counterclockwise seen from outside
+	[[nodiscard]] std::array<Vector3, 3> getCorners(FaceId id) const;
+	/// Leaves across an edge of a leaf (edges as in FaceLattice): one leaf of the same
+	/// or the next coarser level, or the two leaves of the next finer level along the
+	/// edge. Unused entries are InvalidFaceId.
+	[[nodiscard]] std::array<FaceId, 2> getNeighbors(FaceId leaf, unsigned int edge) const;
+
+	[[nodiscard]] const VertexBuffer& getVertexBuffer() const { return this->vertices; }
+	/// SlotSize indices per slot, slot n starts at SlotSize * n
+	[[nodiscard]] std::span<const unsigned int> getIndices() const { return this->indices; }
+	[[nodiscard]] std::size_t getSlotCount() const { return this->slotFaces.size(); }
+	/// Leaf drawn by a slot, InvalidFaceId for an unused slot
+	[[nodiscard]] FaceId getSlotFace(const std::size_t slot) const { return this->slotFaces[slot]; }
+
+	/// Calls function(id) for every leaf, in slot order
+	template <typename Function>
+	void forEachLeaf(Function&& function) const {
+		for (const FaceId id : this->slotFaces) {
+			if (id != InvalidFaceId)
+				function(id);
+		}
+	}
+
+private:
+	/// Back to the 20 faces of the icosahedron
+	void reset(unsigned int maxLevel);
+
+	/// Vertex of a lattice point, created from the vertices of its edge if missing.
+	/// Every split face holds one reference to each of its three midpoints.
+	unsigned int acquireMidpoint(FaceId baseFace, unsigned int level, const std::array<LatticePoint, 3>& corners,
+		unsigned int edge);
+	/// Drops the reference, the vertex is freed for reuse with the last one
+	void releaseMidpoint(FaceId baseFace, unsigned int level, const std::array<LatticePoint, 3>& corners,
+		unsigned int edge);
+	[[nodiscard]] unsigned int vertexOf(FaceId baseFace, unsigned int level, const LatticePoint& point) const;
+
+	void addLeaf(FaceId id);
+	void removeLeaf(FaceId id);
+	/// Replaces a leaf by its four children and queues it for restoreRestriction
+	void splitFace(FaceId id);
+	/// Whether the children of a split face can be merged without breaking the restriction
+	[[nodiscard]] bool canMerge(FaceId id) const;
+	/// Splits the face and any coarser ancestors it is missing
+	void splitWithAncestors(FaceId id);
+	/// Edges (bits 0-2) whose same level neighbor is split
+	[[nodiscard]] unsigned int finerEdges(FaceId id, const std::array<LatticePoint, 3>& corners) const;
+	/// Splits coarser faces until the refinement is restricted again, for all queued splits
+	void restoreRestriction();
+	/// Rewrites the index slots of the leaves marked as changed
+	void writeChangedLeaves();
+	void writeLeaf(FaceId id, unsigned int slot);
+
+	VertexNumbering vertexNumbering;
+	FaceLattice lattice;
+	unsigned int maxLevel{0};
+
+	/// Nodes of the hash maps below. Refine and coarsen insert and erase entries all the
+	/// time, the pool recycles their nodes instead of going to the heap for every one,
+	/// and frees them all at once on destruction.
+	std::pmr::unsynchronized_pool_resource nodePool;
+
+	VertexBuffer vertices;
+	std::pmr::unordered_map<unsigned int, unsigned int> vertexSlots{&this->nodePool}; /// global vertex index -> vertex
+	std::vector<unsigned int> vertexReferences;
+	std::vector<unsigned int> freeVertices;
+
+	std::pmr::unordered_set<FaceId> splitFaces{&this->nodePool};
+	std::pmr::unordered_map<FaceId, unsigned int> leafSlots{&this->nodePool};
+	std::vector<FaceId> slotFaces;
+	std::vector<unsigned int> freeSlots;
+	std::vector<unsigned int> indices;
+
+	std::vector<FaceId> queuedSplits;
+	std::vector<FaceId> changedLeaves;
+	std::vector<unsigned int> changedSlots;
+	std::vector<unsigned int> changedVertices;
+};
+
+template <typename Predicate>
+void AdaptiveIcosphere::subdivide(Predicate&& predicate, const unsigned int maxLevel) {
+	this->reset(maxLevel);
+
+	/// Breadth first, level by level
+	std::vector<FaceId> current;
+	std::vector<FaceId> next;
+	for (FaceId id = 0; id < 20; ++id) {
+		current.push_back(id);
+	}
+	for (unsigned int level = 0; level < this->maxLevel && !current.empty(); ++level) {
+		next.clear();
+		for (const FaceId id : current) {
+			if (!predicate(id, this->getCorners(id)))
+				continue;
+			this->splitFace(id);
+			for (unsigned int slot = 0; slot < 4; ++slot) {
+				next.push_back(faceid::childOf(id, slot));
+			}
+		}
+		std::swap(current, next);
+	}
+
+	this->restoreRestriction();
+	this->writeChangedLeaves();
+}
+} /// namespace lillugsi::planet
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+namespace lillugsi::planet {
+/// std::allocator with a minimum alignment, so SIMD loads of the first
+/// element and of every multiple of the alignment never straddle a cache line
+template <typename T, std::size_t Alignment = 64>
+struct AlignedAllocator {
+	using value_type = T;
+
+	template <typename U>
+	struct rebind {
+		using other = AlignedAllocator<U, Alignment>;
+	};
+
+	AlignedAllocator() = default;
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+	T* allocate(const std::size_t count) {
+		return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t{Alignment}));
+	}
+	void deallocate(T* pointer, std::size_t) {
+		::operator delete(pointer, std::align_val_t{Alignment});
+	}
+
+	template <typename U>
+	bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+};
+} /// namespace lillugsi::planet
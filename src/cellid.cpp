@@ -0,0 +1,299 @@
+#include "cellid.h"
+#include "icosphere.h"
+#include "vertexnumbering.h"
+#include "log.h"
+
+#include <algorithm> /// For std::min
+#include <bit> /// For std::countr_zero
+#include <utility>
+
+namespace lillugsi::planet {
+namespace {
+/// Where the curve enters and leaves a face, as corner indices in its stored order
+constexpr unsigned int curveState(const unsigned int entry, const unsigned int exit) {
+	return entry * 3 + exit;
+}
+
+/// One child along the curve: its slot (or position, when encoding) and its curve state
+struct CurveStep {
+	std::uint8_t index;
+	std::uint8_t state;
+};
+
+struct CurveTables {
+	/// [state][position along the curve] -> child slot, and [state][slot] -> position
+	std::array<std::array<CurveStep, 4>, 9> decode{};
+	std::array<std::array<CurveStep, 4>, 9> encode{};
+	/// Base faces along the curve and their curve states
+	std::array<FaceId, 20> baseFaces{};
+	std::array<std::uint8_t, 20> basePositions{};
+	std::array<std::uint8_t, 20> baseStates{};
+	std::array<std::array<unsigned int, 3>, 20> baseFaceVertices{};
+	std::array<Vector3, 12> baseVertices{};
+};
+
+unsigned int cornerIndex(const std::array<LatticePoint, 3>& corners, const LatticePoint& point) {
+	return corners[0] == point ? 0 : (corners[1] == point ? 1 : 2);
+}
+
+/// Entering at corner A and leaving at corner B, with C the third corner, the children
+/// are walked as corner child A, corner child C, center, corner child B. Each child
+/// starts at the point where the previous one ended: A, mid AC, mid BC, mid AB, B.
+/// The order of the corners inside the children does not depend on the level, so the
+/// tables are built once on the base lattice triangle.
+void buildChildTables(CurveTables& tables) {
+	const std::array<LatticePoint, 3> corners = VertexNumbering::baseCorners();
+	for (unsigned int entry = 0; entry < 3; ++entry) {
+		for (unsigned int exit = 0; exit < 3; ++exit) {
+			if (entry == exit)
+				continue;
+			const unsigned int other = 3 - entry - exit;
+			const std::array<LatticePoint, 5> stops = {corners[entry].doubled(), corners[entry] + corners[other],
+				corners[exit] + corners[other], corners[entry] + corners[exit], corners[exit].doubled()};
+			const std::array<unsigned int, 4> slots = {entry, other, 3, exit};
+			const unsigned int state = curveState(entry, exit);
+			for (unsigned int position = 0; position < 4; ++position) {
+				const std::array<LatticePoint, 3> child = VertexNumbering::childCorners(corners, slots[position]);
+				const auto childState = static_cast<std::uint8_t>(
+					curveState(cornerIndex(child, stops[position]), cornerIndex(child, stops[position + 1])));
+				tables.decode[state][position] = {static_cast<std::uint8_t>(slots[position]), childState};
+				tables.encode[state][slots[position]] = {static_cast<std::uint8_t>(position), childState};
+			}
+		}
+	}
+}
+
+/// Depth-first search for an order of the base faces in which consecutive faces share
+/// an edge and the curve leaves each face at a vertex of that edge
+bool findBaseCurve(CurveTables& tables, std::array<bool, 20>& used, const unsigned int count,
+	const unsigned int entryVertex) {
+	const FaceId face = tables.baseFaces[count - 1];
+	const auto& vertices = tables.baseFaceVertices[face];
+	const unsigned int entry = vertices[0] == entryVertex ? 0 : (vertices[1] == entryVertex ? 1 : 2);
+	for (unsigned int exit = 0; exit < 3; ++exit) {
+		if (exit == entry)
+			continue;
+		tables.baseStates[face] = static_cast<std::uint8_t>(curveState(entry, exit));
+		if (count == 20)
+			return true;
+		for (FaceId next = 0; next < 20; ++next) {
+			if (used[next])
+				continue;
+			unsigned int shared = 0;
+			bool hasExit = false;
+			for (const unsigned int vertex : tables.baseFaceVertices[next]) {
+				for (const unsigned int own : vertices) {
+					shared += vertex == own;
+				}
+				hasExit = hasExit || vertex == vertices[exit];
+			}
+			if (shared != 2 || !hasExit)
+				continue;
+			used[next] = true;
+			tables.baseFaces[count] = next;
+			if (findBaseCurve(tables, used, count + 1, vertices[exit]))
+				return true;
+			used[next] = false;
+		}
+	}
+	return false;
+}
+
+CurveTables buildCurveTables() {
+	CurveTables tables;
+	buildChildTables(tables);
+
+	const Icosphere icosahedron(FaceStorage::Flat);
+	for (FaceId baseFace = 0; baseFace < 20; ++baseFace) {
+		tables.baseFaceVertices[baseFace] = icosahedron.getFaces()[baseFace].vertexIndices;
+	}
+	for (unsigned int vertex = 0; vertex < 12; ++vertex) {
+		tables.baseVertices[vertex] = icosahedron.getVertexBuffer()[vertex];
+	}
+
+	std::array<bool, 20> used{};
+	used[0] = true;
+	tables.baseFaces[0] = 0;
+	if (!findBaseCurve(tables, used, 1, tables.baseFaceVertices[0][0]))
+		LOG_ERROR("CellId: no curve over the base faces");
+	for (unsigned int position = 0; position < 20; ++position) {
+		tables.basePositions[tables.baseFaces[position]] = static_cast<std::uint8_t>(position);
+	}
+	return tables;
+}
+
+const CurveTables& curveTables() {
+	static const CurveTables tables = buildCurveTables();
+	return tables;
+}
+
+/// Bit of the marker of a cell on the given level
+constexpr std::uint64_t markerOf(const unsigned int level) {
+	return std::uint64_t{1} << (2 * (CellId::MaxLevel - level));
+}
+
+Vector3 midpoint(const Vector3& first, const Vector3& second) {
+	return ((first + second) * 0.5f).normalized();
+}
+} /// namespace
+
+CellId CellId::fromBaseFace(const FaceId baseFace) {
+	if (baseFace >= 20)
+		return {};
+	const std::uint64_t position = curveTables().basePositions[baseFace];
+	return CellId((position << (64 - BaseBits)) | markerOf(0));
+}
+
+CellId CellId::fromFaceId(const FaceId id) {
+	if (id == InvalidFaceId)
+		return {};
+	const CurveTables& tables = curveTables();
+	const unsigned int level = faceid::levelOf(id);
+	const FaceId baseFace = faceid::baseFaceOf(id);
+	const FaceId path = faceid::pathOf(id);
+
+	std::uint64_t value = CellId::fromBaseFace(baseFace).value - markerOf(0);
+	unsigned int state = tables.baseStates[baseFace];
+	for (unsigned int depth = 1; depth <= level; ++depth) {
+		const CurveStep step = tables.encode[state][(path >> (2 * (level - depth))) & 3u];
+		value |= std::uint64_t{step.index} << (64 - BaseBits - 2 * depth);
+		state = step.state;
+	}
+	return CellId(value | markerOf(level));
+}
+
+FaceId CellId::toFaceId() const {
+	if (!this->isValid() || this->getLevel() > faceid::MaxLevel)
+		return InvalidFaceId;
+	const CurveTables& tables = curveTables();
+	const unsigned int level = this->getLevel();
+	const FaceId baseFace = this->getBaseFace();
+
+	FaceId path = 0;
+	unsigned int state = tables.baseStates[baseFace];
+	for (unsigned int depth = 1; depth <= level; ++depth) {
+		const auto position = static_cast<unsigned int>(this->value >> (64 - BaseBits - 2 * depth)) & 3u;
+		const CurveStep step = tables.decode[state][position];
+		path = (path << 2) | step.index;
+		state = step.state;
+	}
+	return faceid::makeFaceId(baseFace, level, path);
+}
+
+std::vector<FaceId> CellId::getCurveOrder(unsigned int level) {
+	const CurveTables& tables = curveTables();
+	level = std::min(level, faceid::MaxLevel);
+
+	/// Level by level, each face followed by its curve state
+	std::vector<std::pair<FaceId, std::uint8_t>> current;
+	std::vector<std::pair<FaceId, std::uint8_t>> next;
+	current.reserve(faceid::levelFaceCount(level));
+	for (const FaceId baseFace : tables.baseFaces) {
+		current.emplace_back(baseFace, tables.baseStates[baseFace]);
+	}
+	for (unsigned int depth = 0; depth < level; ++depth) {
+		next.clear();
+		next.reserve(4 * current.size());
+		const FaceId offset = faceid::levelOffset(depth);
+		const FaceId childOffset = faceid::levelOffset(depth + 1);
+		for (const auto& [id, state] : current) {
+			const FaceId firstChild = childOffset + 4 * (id - offset);
+			for (const CurveStep step : tables.decode[state]) {
+				next.emplace_back(firstChild + step.index, step.state);
+			}
+		}
+		std::swap(current, next);
+	}
+
+	std::vector<FaceId> result;
+	result.reserve(current.size());
+	for (const auto& entry : current) {
+		result.push_back(entry.first);
+	}
+	return result;
+}
+
+bool CellId::isValid() const {
+	if (this->value == 0 || (this->value >> (64 - BaseBits)) >= 20)
+		return false;
+	const int zeros = std::countr_zero(this->value);
+	return zeros % 2 == 0 && zeros <= static_cast<int>(2 * MaxLevel);
+}
+
+unsigned int CellId::getLevel() const {
+	return MaxLevel - static_cast<unsigned int>(std::countr_zero(this->value)) / 2;
+}
+
+FaceId CellId::getBaseFace() const {
+	return curveTables().baseFaces[this->value >> (64 - BaseBits)];
+}
+
+CellId CellId::getParent() const {
+	const unsigned int level = this->getLevel();
+	if (level == 0)
+		return {};
+	return this->getParent(level - 1);
+}
+
+CellId CellId::getParent(const unsigned int level) const {
+	if (level > this->getLevel())
+		return {};
+	const std::uint64_t marker = markerOf(level);
+	return CellId((this->value & ~(2 * marker - 1)) | marker);
+}
+
+CellId CellId::getChild(const unsigned int position) const {
+	if (this->getLevel() >= MaxLevel || position >= 4)
+		return {};
+	const std::uint64_t marker = this->lowestBit() >> 2;
+	return CellId(this->value - this->lowestBit() + (2 * position + 1) * marker);
+}
+
+unsigned int CellId::getChildPosition() const {
+	return static_cast<unsigned int>(this->value >> (std::countr_zero(this->value) + 1)) & 3u;
+}
+
+CellId CellId::getRangeMin() const {
+	return CellId(this->value - (this->lowestBit() - 1));
+}
+
+CellId CellId::getRangeMax() const {
+	return CellId(this->value + (this->lowestBit() - 1));
+}
+
+bool CellId::contains(const CellId other) const {
+	return other >= this->getRangeMin() && other <= this->getRangeMax();
+}
+
+std::array<Vector3, 3> CellId::getCorners() const {
+	const CurveTables& tables = curveTables();
+	const FaceId baseFace = this->getBaseFace();
+	const auto& vertices = tables.baseFaceVertices[baseFace];
+	std::array<Vector3, 3> corners = {tables.baseVertices[vertices[0]], tables.baseVertices[vertices[1]],
+		tables.baseVertices[vertices[2]]};
+
+	/// Same corner order as VertexNumbering::childCorners
+	unsigned int state = tables.baseStates[baseFace];
+	const unsigned int level = this->getLevel();
+	for (unsigned int depth = 1; depth <= level; ++depth) {
+		const auto position = static_cast<unsigned int>(this->value >> (64 - BaseBits - 2 * depth)) & 3u;
+		const CurveStep step = tables.decode[state][position];
+		const Vector3 mid1 = midpoint(corners[0], corners[1]);
+		const Vector3 mid2 = midpoint(corners[1], corners[2]);
+		const Vector3 mid3 = midpoint(corners[2], corners[0]);
+		switch (step.index) {
+		case 0: corners = {mid3, mid1, corners[0]}; break;
+		case 1: corners = {mid2, corners[1], mid1}; break;
+		case 2: corners = {corners[2], mid2, mid3}; break;
+		default: corners = {mid3, mid2, mid1}; break;
+		}
+		state = step.state;
+	}
+	return corners;
+}
+
+Vector3 CellId::getCenter() const {
+	const std::array<Vector3, 3> corners = this->getCorners();
+	return (corners[0] + corners[1] + corners[2]).normalized();
+}
+} /// namespace lillugsi::planet
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "faceid.h"
+#include "vector3.h"
+#include <array>
+#include <compare>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace lillugsi::planet {
+/// Stable 64-bit cell key, in the spirit of S2 cell ids.
+/// Unlike a FaceId it does not depend on how deep the sphere was subdivided, so it
+/// survives rebuilds and process boundaries and can key databases or shards.
+///
+/// Layout from the top: 5 bits for the position of the base face along the curve,
+/// then 2 bits per level for the position of the child along the curve, then a
+/// single marker bit, then zeros:
+///   [base:5][digit:2] * level [1][0...]
+/// The digits follow a Sierpinski-style curve over the icosahedral net: the
+/// children of a face are ordered so that each one starts where the previous one
+/// ended, and the base faces are ordered so that consecutive ones share an edge.
+/// Sorting ids therefore walks the sphere along a continuous curve, every cell is
+/// the id range [getRangeMin(), getRangeMax()] of its descendants, and ranges of
+/// ids cover spatially coherent regions.
+class CellId {
+public:
+	/// Deepest level that fits into 64 bits. FaceIds only reach faceid::MaxLevel.
+	static constexpr unsigned int MaxLevel = 29;
+
+	constexpr CellId() = default;
+	explicit constexpr CellId(const std::uint64_t value) : value(value) {}
+
+	/// Cell of a face, invalid for InvalidFaceId
+	[[nodiscard]] static CellId fromFaceId(FaceId id);
+	/// Base face number 0-19 as in the FaceStore
+	[[nodiscard]] static CellId fromBaseFace(FaceId baseFace);
+	/// Face of the cell, InvalidFaceId if the cell is deeper than faceid::MaxLevel
+	[[nodiscard]] FaceId toFaceId() const;
+	/// All faces of a level (at most faceid::MaxLevel) in CellId order, O(faces)
+	[[nodiscard]] static std::vector<FaceId> getCurveOrder(unsigned int level);
+
+	[[nodiscard]] constexpr std::uint64_t getValue() const { return this->value; }
+	[[nodiscard]] bool isValid() const;
+	[[nodiscard]] unsigned int getLevel() const;
+	[[nodiscard]] FaceId getBaseFace() const;
+
+	/// Hierarchy, all O(1) bit operations on valid cells
+	[[nodiscard]] CellId getParent() const;
+	[[nodiscard]] CellId getParent(unsigned int level) const;
+	/// Child at a position 0-3 along the curve, invalid on MaxLevel
+	[[nodiscard]] CellId getChild(unsigned int position) const;
+	/// Position 0-3 of the cell among its siblings along the curve
+	[[nodiscard]] unsigned int getChildPosition() const;
+	/// Smallest and largest id of all descendants, deepest level
+	[[nodiscard]] CellId getRangeMin() const;
+	[[nodiscard]] CellId getRangeMax() const;
+	[[nodiscard]] bool contains(CellId other) const;
+
+	/// Unit direction of the centroid of the cell's corners, computed with the
+	/// midpoint formula of the subdivision, so it matches the Icosphere face exactly
+	[[nodiscard]] Vector3 getCenter() const;
+	/// Corner directions in the stored order of the face
+	[[nodiscard]] std::array<Vector3, 3> getCorners() const;
+
+	constexpr auto operator<=>(const CellId& other) const = default;
+
+private:
+	static constexpr unsigned int BaseBits = 5;
+	[[nodiscard]] std::uint64_t lowestBit() const { return this->value & (~this->value + 1); }
+
+	std::uint64_t value{0};
+};
+} /// namespace lillugsi::planet
+
+template <>
+struct std::hash<lillugsi::planet::CellId> {
+	std::size_t operator()(const lillugsi::planet::CellId& id) const noexcept {
+		return std::hash<std::uint64_t>{}(id.getValue());
+	}
+};
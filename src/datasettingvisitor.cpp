@@ -1,4 +1,5 @@
 #include "datasettingvisitor.h"
+#include "log.h"
 
 namespace lillugsi::planet {
 void DataSettingVisitor::visit(const std::shared_ptr<Face> face) {
@@ -8,12 +9,35 @@ void DataSettingVisitor::visit(const std::shared_ptr<Face> face) {
 	/// This is where you implement the logic to set the data for the face
 	const float data = calculateDataForFace(face);
 	face->setData(data);
-	std::cout << "calculateDataForFace Face object: " << *face << std::endl;
+	LOG_TRACE("calculateDataForFace Face object: ", *face);
 }
 
-float DataSettingVisitor::calculateDataForFace(const std::shared_ptr<Face>& face) {
+void DataSettingVisitor::visit(FaceStore& faces, const FaceId id) {
+	if (id == InvalidFaceId) return;
+
+	const float data = calculateDataForFace(faces[id]);
+	faces.setData(id, data);
+	LOG_TRACE("calculateDataForFace Face object: ", faces[id]);
+}
+
+void DataSettingVisitor::visit(FaceChannel<float>& channel, const FaceId id) {
+	if (id == InvalidFaceId) return;
+
+	channel[id] = calculateDataForFace(id);
+	LOG_TRACE("calculateDataForFace ", channel.getName(), "[", id, "]: ", channel[id]);
+}
+
+float DataSettingVisitor::calculateDataForFace([[maybe_unused]] const std::shared_ptr<Face>& face) {
 	/// Implement your logic to calculate data for a face
 	/// This is just a placeholder implementation
 	return (float)rand()/(float)(RAND_MAX/1.0f); /// Placeholder return value
 }
-} /// namespace lillugsi::planet
\ No newline at end of file
+float DataSettingVisitor::calculateDataForFace([[maybe_unused]] const FlatFace& face) {
+	/// Same placeholder as for the shared_ptr faces
+	return (float)rand()/(float)(RAND_MAX/1.0f);
+}
+float DataSettingVisitor::calculateDataForFace([[maybe_unused]] FaceId id) {
+	/// Same placeholder, channels only know the FaceId
+	return (float)rand()/(float)(RAND_MAX/1.0f);
+}
+} /// namespace lillugsi::planet
@@ -1,13 +1,19 @@
 #pragma once
 
 #include "face.h"
+#include "facestore.h"
+#include "facechannel.h"
 
 namespace lillugsi::planet {
 class DataSettingVisitor : public FaceVisitor {
 public:
 	void visit(std::shared_ptr<Face> face) override;
+	void visit(FaceStore& faces, FaceId id) override;
+	void visit(FaceChannel<float>& channel, FaceId id) override;
 
 private:
 	static float calculateDataForFace(const std::shared_ptr<Face>& face);
+	static float calculateDataForFace(const FlatFace& face);
+	static float calculateDataForFace(FaceId id);
 };
 } /// namespace lillugsi::planet
\ No newline at end of file
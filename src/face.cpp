@@ -1,4 +1,5 @@
 #include "face.h"
+#include "log.h"
 
 #include <cstddef>
 #include <iostream>
@@ -33,7 +34,7 @@ void Face::setNeighbor(const unsigned int index, std::shared_ptr<Face> neighbor)
 void Face::addNeighbor(const std::shared_ptr<Face>& neighbor) {
 	for (size_t index = 0; index < this->neighbors.size(); ++index) {
 		if (neighbor == this->neighbors[index]) {
-			std::cout << "addNeighbor: neighbor already exists\n";
+			LOG_DEBUG("addNeighbor: neighbor already exists");
 			return;
 		}
 	}
@@ -59,7 +60,7 @@ void Face::addChild(const std::shared_ptr<Face>& child) {
 			return;
 		}
 	}
-	std::cout << "added no child\n";
+	LOG_WARN("addChild: added no child, all four slots are taken");
 }
 
 void Face::setParent(std::weak_ptr<Face> parent) {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "vector3.h"
+#include "faceid.h"
 #include <array>
 #include <memory> /// Include for smart pointers
 #include <iostream>
@@ -54,9 +55,17 @@ private:
 	std::array<unsigned int, 3> vertexIndices{{0, 0, 0}};
 };
 
+class FaceStore;
+template <typename T>
+class FaceChannel;
+
 class FaceVisitor {
 public:
 	virtual ~FaceVisitor() = default;
 	virtual void visit(std::shared_ptr<Face> face) = 0;
+	/// Called instead of the shared_ptr overload when the Icosphere uses flat face storage
+	virtual void visit([[maybe_unused]] FaceStore& faces, [[maybe_unused]] FaceId id) {}
+	/// Called by Icosphere::applyVisitor(visitor, channel) for every face, in both storage modes
+	virtual void visit([[maybe_unused]] FaceChannel<float>& channel, [[maybe_unused]] FaceId id) {}
 };
 } /// namespace lillugsi::planet
\ No newline at end of file
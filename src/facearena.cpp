@@ -0,0 +1,98 @@
+#include "facearena.h"
+#include "log.h"
+
+#include <algorithm> /// For std::min and std::max
+#include <cstdint>
+#include <new>
+
+namespace lillugsi::planet {
+namespace {
+constexpr std::size_t roundUp(const std::size_t value, const std::size_t multiple) {
+	return (value + multiple - 1) / multiple * multiple;
+}
+} /// namespace
+
+FaceArena::~FaceArena() {
+	this->release();
+}
+
+void FaceArena::reserve(const std::size_t bytes) {
+	const Block* block = this->current.load(std::memory_order_relaxed);
+	if (block != nullptr && block->used.load(std::memory_order_relaxed) + bytes <= block->size)
+		return;
+	this->addBlock(bytes);
+}
+
+void FaceArena::release() {
+	if (!this->blocks.empty())
+		LOG_DEBUG("FaceArena::release: ", this->blocks.size(), " blocks, ", this->getCapacity(), " bytes");
+	this->current.store(nullptr, std::memory_order_relaxed);
+	for (const std::unique_ptr<Block>& block : this->blocks) {
+		::operator delete(block->memory, std::align_val_t{BlockAlignment});
+	}
+	this->blocks.clear();
+	this->nextBlockSize = MinimumBlockSize;
+}
+
+std::size_t FaceArena::getAllocatedBytes() const {
+	std::size_t bytes = 0;
+	for (const std::unique_ptr<Block>& block : this->blocks) {
+		bytes += std::min(block->used.load(std::memory_order_relaxed), block->size);
+	}
+	return bytes;
+}
+
+std::size_t FaceArena::getCapacity() const {
+	std::size_t bytes = 0;
+	for (const std::unique_ptr<Block>& block : this->blocks) {
+		bytes += block->size;
+	}
+	return bytes;
+}
+
+void* FaceArena::do_allocate(const std::size_t bytes, const std::size_t alignment) {
+	/// Alignments above the granularity are rare and paid for with padding
+	const std::size_t padded = roundUp(bytes, Granularity) + (alignment > Granularity ? alignment : 0);
+
+	Block* block = this->current.load(std::memory_order_acquire);
+	if (block != nullptr) {
+		if (void* pointer = allocateFrom(*block, padded, alignment))
+			return pointer;
+	}
+
+	/// The block is full: the first thread to get here appends the next one,
+	/// the others retry on it
+	const std::lock_guard lock(this->mutex);
+	block = this->current.load(std::memory_order_acquire);
+	if (block != nullptr) {
+		if (void* pointer = allocateFrom(*block, padded, alignment))
+			return pointer;
+	}
+	return allocateFrom(this->addBlock(padded), padded, alignment);
+}
+
+void* FaceArena::allocateFrom(Block& block, const std::size_t bytes, const std::size_t alignment) {
+	const std::size_t offset = block.used.fetch_add(bytes, std::memory_order_relaxed);
+	if (offset + bytes > block.size)
+		return nullptr;
+	std::byte* pointer = block.memory + offset;
+	if (alignment > Granularity)
+		pointer += roundUp(reinterpret_cast<std::uintptr_t>(pointer), alignment) - reinterpret_cast<std::uintptr_t>(pointer);
+	return pointer;
+}
+
+FaceArena::Block& FaceArena::addBlock(const std::size_t size) {
+	auto block = std::make_unique<Block>();
+	block->size = roundUp(std::max(size, this->nextBlockSize), BlockAlignment);
+	block->memory = static_cast<std::byte*>(::operator new(block->size, std::align_val_t{BlockAlignment}));
+	/// Blocks grow geometrically, reserved blocks are sized exactly and do not count
+	if (size <= this->nextBlockSize)
+		this->nextBlockSize = std::min(2 * this->nextBlockSize, MaximumBlockSize);
+	LOG_DEBUG("FaceArena: new block of ", block->size, " bytes");
+
+	Block& result = *block;
+	this->blocks.push_back(std::move(block));
+	this->current.store(&result, std::memory_order_release);
+	return result;
+}
+} /// namespace lillugsi::planet
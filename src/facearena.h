@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+
+namespace lillugsi::planet {
+/// Bump allocator for the Face nodes of an Icosphere, a memory resource for
+/// std::allocate_shared through FaceAllocator.
+/// An allocation advances the offset of the current block with one atomic add, so the
+/// threads of a parallel subdivision can allocate at the same time. Nodes are never
+/// freed one by one: deallocate does nothing and release() or the destructor returns
+/// all blocks at once, however many nodes they hold.
+class FaceArena final : public std::pmr::memory_resource {
+public:
+	FaceArena() = default;
+	~FaceArena() override;
+
+	FaceArena(const FaceArena& other) = delete;
+	FaceArena& operator=(const FaceArena& other) = delete;
+
+	/// Makes sure the next bytes of allocations fit into the current block, not thread safe
+	void reserve(std::size_t bytes);
+	/// Frees all blocks, not thread safe. Nothing allocated from the arena may be used afterwards.
+	void release();
+
+	/// Bytes handed out, including padding, and bytes held in blocks
+	[[nodiscard]] std::size_t getAllocatedBytes() const;
+	[[nodiscard]] std::size_t getCapacity() const;
+	[[nodiscard]] std::size_t getBlockCount() const { return this->blocks.size(); }
+
+private:
+	/// Every allocation is padded to a multiple of this, which keeps all offsets aligned to it
+	static constexpr std::size_t Granularity = alignof(std::max_align_t);
+	static constexpr std::size_t BlockAlignment = 64;
+	static constexpr std::size_t MinimumBlockSize = 64 << 10;
+	static constexpr std::size_t MaximumBlockSize = 64 << 20;
+
+	struct Block {
+		std::byte* memory{nullptr};
+		std::size_t size{0};
+		std::atomic<std::size_t> used{0};
+	};
+
+	void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+	void do_deallocate([[maybe_unused]] void* pointer, [[maybe_unused]] std::size_t bytes,
+		[[maybe_unused]] std::size_t alignment) override {}
+	[[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+		return this == &other;
+	}
+
+	/// Takes bytes from a block, nullptr if it is full
+	[[nodiscard]] static void* allocateFrom(Block& block, std::size_t bytes, std::size_t alignment);
+	/// Appends a block of at least size bytes and makes it the current one, called under the mutex
+	Block& addBlock(std::size_t size);
+
+	std::vector<std::unique_ptr<Block>> blocks;
+	std::atomic<Block*> current{nullptr};
+	std::mutex mutex; /// Guards blocks and nextBlockSize when a block runs full
+	std::size_t nextBlockSize{MinimumBlockSize};
+};
+
+/// Allocator for std::allocate_shared that shares ownership of its FaceArena.
+/// The control block of every node keeps a copy, so the arena lives until the last
+/// node allocated from it is gone, also when shared_ptrs outlive the Icosphere.
+template <typename T>
+class FaceAllocator {
+public:
+	using value_type = T;
+
+	explicit FaceAllocator(std::shared_ptr<FaceArena> arena) : arena(std::move(arena)) {}
+	template <typename U>
+	FaceAllocator(const FaceAllocator<U>& other) : arena(other.getArena()) {}
+
+	[[nodiscard]] T* allocate(const std::size_t count) {
+		return static_cast<T*>(this->arena->allocate(count * sizeof(T), alignof(T)));
+	}
+	void deallocate(T* pointer, const std::size_t count) {
+		this->arena->deallocate(pointer, count * sizeof(T), alignof(T));
+	}
+
+	[[nodiscard]] const std::shared_ptr<FaceArena>& getArena() const { return this->arena; }
+
+	template <typename U>
+	bool operator==(const FaceAllocator<U>& other) const { return this->arena == other.getArena(); }
+
+private:
+	std::shared_ptr<FaceArena> arena;
+};
+} /// namespace lillugsi::planet
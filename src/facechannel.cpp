@@ -0,0 +1,19 @@
+#include "facechannel.h"
+
+namespace lillugsi::planet {
+std::vector<std::string> FaceChannels::getNames() const {
+	std::vector<std::string> names;
+	names.reserve(this->channels.size());
+	for (const auto& [name, channel] : this->channels) {
+		names.push_back(name);
+	}
+	return names;
+}
+
+void FaceChannels::setLevelCount(const unsigned int levelCount) {
+	this->levelCount = levelCount;
+	for (auto& [name, channel] : this->channels) {
+		channel->setLevelCount(levelCount);
+	}
+}
+} /// namespace lillugsi::planet
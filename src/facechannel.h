@@ -0,0 +1,138 @@
+#pragma once
+
+#include "faceid.h"
+#include "alignedallocator.h"
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <typeindex>
+#include <utility>
+#include <vector>
+
+namespace lillugsi::planet {
+/// Untyped part of a channel, lets FaceChannels resize channels of any type
+class FaceChannelBase {
+public:
+	virtual ~FaceChannelBase() = default;
+
+	[[nodiscard]] const std::string& getName() const { return this->name; }
+	[[nodiscard]] unsigned int getLevelCount() const { return this->levelCount; }
+	[[nodiscard]] virtual std::type_index getType() const = 0;
+	/// Keeps the values of the levels that stay, new faces get the default value
+	virtual void setLevelCount(unsigned int levelCount) = 0;
+
+protected:
+	explicit FaceChannelBase(std::string name) : name(std::move(name)) {}
+
+	std::string name;
+	unsigned int levelCount{0};
+};
+
+/// One value of type T per face, in an aligned array indexed by FaceId.
+/// As in the FaceStore every level is a contiguous range, so getLevel() is the
+/// array of one level and a scan over a field streams only that field.
+template <typename T>
+class FaceChannel : public FaceChannelBase {
+	static_assert(!std::is_same_v<T, bool>, "std::vector<bool> is not contiguous, use std::uint8_t");
+
+public:
+	FaceChannel(std::string name, const unsigned int levelCount, const T defaultValue = T{})
+	: FaceChannelBase(std::move(name)), defaultValue(defaultValue) {
+		this->setLevelCount(levelCount);
+	}
+
+	[[nodiscard]] std::type_index getType() const override { return typeid(T); }
+
+	void setLevelCount(unsigned int levelCount) override {
+		levelCount = std::min(levelCount, faceid::MaxLevel + 1);
+		this->values.resize(faceid::levelOffset(levelCount), this->defaultValue);
+		this->levelCount = levelCount;
+	}
+
+	[[nodiscard]] T& operator[](const FaceId id) { return this->values[id]; }
+	[[nodiscard]] const T& operator[](const FaceId id) const { return this->values[id]; }
+	[[nodiscard]] std::size_t size() const { return this->values.size(); }
+
+	/// Values of all levels, indexed by FaceId
+	[[nodiscard]] std::span<T> getValues() { return this->values; }
+	[[nodiscard]] std::span<const T> getValues() const { return this->values; }
+	/// Values of one level, indexed by FaceId - levelOffset(level); empty if the level does not exist
+	[[nodiscard]] std::span<T> getLevel(const unsigned int level) {
+		if (level >= this->levelCount)
+			return {};
+		return this->getValues().subspan(faceid::levelOffset(level), faceid::levelFaceCount(level));
+	}
+	[[nodiscard]] std::span<const T> getLevel(const unsigned int level) const {
+		if (level >= this->levelCount)
+			return {};
+		return this->getValues().subspan(faceid::levelOffset(level), faceid::levelFaceCount(level));
+	}
+
+	/// Bulk fill
+	void fill(const T value) {
+		std::fill(this->values.begin(), this->values.end(), value);
+	}
+	void fill(const unsigned int level, const T value) {
+		const std::span<T> range = this->getLevel(level);
+		std::fill(range.begin(), range.end(), value);
+	}
+
+	/// Calls function(id, value) for every face of a level, a plain loop the compiler can vectorize
+	template <typename Function>
+	void forEach(const unsigned int level, Function&& function) {
+		const std::span<T> range = this->getLevel(level);
+		const FaceId first = faceid::levelOffset(level);
+		for (std::size_t index = 0; index < range.size(); ++index) {
+			function(static_cast<FaceId>(first + index), range[index]);
+		}
+	}
+
+private:
+	T defaultValue;
+	std::vector<T, AlignedAllocator<T>> values;
+};
+
+/// Named per-face channels of an Icosphere, all sized to its level count
+class FaceChannels {
+public:
+	/// Adds a channel, or returns the existing one if the name is taken by a channel of the same type.
+	/// Returns nullptr if the name is taken by a channel of another type.
+	template <typename T>
+	FaceChannel<T>* add(const std::string& name, const T defaultValue = T{}) {
+		const auto it = this->channels.find(name);
+		if (it != this->channels.end())
+			return this->get<T>(name);
+		auto channel = std::make_unique<FaceChannel<T>>(name, this->levelCount, defaultValue);
+		FaceChannel<T>* result = channel.get();
+		this->channels.emplace(name, std::move(channel));
+		return result;
+	}
+
+	/// nullptr if there is no channel of this name and type
+	template <typename T>
+	[[nodiscard]] FaceChannel<T>* get(const std::string& name) {
+		return const_cast<FaceChannel<T>*>(std::as_const(*this).get<T>(name));
+	}
+	template <typename T>
+	[[nodiscard]] const FaceChannel<T>* get(const std::string& name) const {
+		const auto it = this->channels.find(name);
+		if (it == this->channels.end() || it->second->getType() != typeid(T))
+			return nullptr;
+		return static_cast<const FaceChannel<T>*>(it->second.get());
+	}
+
+	bool remove(const std::string& name) { return this->channels.erase(name) > 0; }
+	[[nodiscard]] std::vector<std::string> getNames() const;
+
+	/// Called by Icosphere on subdivision
+	void setLevelCount(unsigned int levelCount);
+	[[nodiscard]] unsigned int getLevelCount() const { return this->levelCount; }
+
+private:
+	std::map<std::string, std::unique_ptr<FaceChannelBase>> channels;
+	unsigned int levelCount{0};
+};
+} /// namespace lillugsi::planet
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <limits>
+
+namespace lillugsi::planet {
+/// 32-bit handle of a face in the flat face storage (see FaceStore)
+using FaceId = std::uint32_t;
+
+/// Marks a missing parent, child or neighbor link
+constexpr FaceId InvalidFaceId = std::numeric_limits<FaceId>::max();
+
+/// Implicit face hierarchy.
+/// Every face is split into exactly four children in a fixed order
+/// (corner 0, corner 1, corner 2, center), so the tree is complete and can be
+/// laid out like a heap: level n starts at levelOffset(n) and holds
+/// 20 * 4^n faces. Within a level a face is its base face (0-19) followed by
+/// a base-4 path with one digit (the child slot) per level:
+///   id = levelOffset(level) + (baseFace << 2 * level) + path
+/// Parent, children and level are computed from the id, nothing is stored.
+namespace faceid {
+/// Deepest level whose ids still fit into 32 bits
+constexpr unsigned int MaxLevel = 13;
+
+/// Number of faces on a level
+constexpr std::uint64_t levelFaceCount(const unsigned int level) {
+	return std::uint64_t{20} << (2 * level);
+}
+
+/// First id of a level, 20 * (4^level - 1) / 3
+constexpr FaceId levelOffset(const unsigned int level) {
+	return static_cast<FaceId>((levelFaceCount(level) - 20) / 3);
+}
+
+/// Level of a face: 3 * id + 20 lies in [20 * 4^level, 20 * 4^(level + 1))
+constexpr unsigned int levelOf(const FaceId id) {
+	/// quotient lies in [4^level, 4^(level + 1)), so its highest bit is 2 * level or 2 * level + 1
+	const std::uint64_t quotient = (std::uint64_t{3} * id + 20) / 20;
+	return static_cast<unsigned int>((std::bit_width(quotient) - 1) / 2);
+}
+
+/// Position of a face within its level
+constexpr FaceId localIndexOf(const FaceId id) {
+	return id - levelOffset(levelOf(id));
+}
+
+constexpr FaceId baseFaceOf(const FaceId id) {
+	return localIndexOf(id) >> (2 * levelOf(id));
+}
+
+/// Child slots from the base face down, two bits per level
+constexpr FaceId pathOf(const FaceId id) {
+	const unsigned int level = levelOf(id);
+	return localIndexOf(id) & ((FaceId{1} << (2 * level)) - 1);
+}
+
+/// Slot (0-3) of a face among its siblings, base faces report 0
+constexpr unsigned int childSlotOf(const FaceId id) {
+	return levelOf(id) == 0 ? 0 : localIndexOf(id) & 3u;
+}
+
+constexpr FaceId makeFaceId(const FaceId baseFace, const unsigned int level, const FaceId path) {
+	return levelOffset(level) + (baseFace << (2 * level)) + path;
+}
+
+constexpr FaceId parentOf(const FaceId id) {
+	const unsigned int level = levelOf(id);
+	if (level == 0)
+		return InvalidFaceId;
+	return levelOffset(level - 1) + ((id - levelOffset(level)) >> 2);
+}
+
+constexpr FaceId childOf(const FaceId id, const unsigned int slot) {
+	const unsigned int level = levelOf(id);
+	if (level >= MaxLevel || slot >= 4)
+		return InvalidFaceId;
+	return levelOffset(level + 1) + ((id - levelOffset(level)) << 2) + slot;
+}
+} /// namespace faceid
+} /// namespace lillugsi::planet
@@ -0,0 +1,111 @@
+#include "facelattice.h"
+
+#include <algorithm> /// For std::min
+
+namespace lillugsi::planet {
+FaceLattice::FaceLattice(const std::array<std::array<unsigned int, 3>, 20>& baseFaceVertices) {
+	/// Icosahedral adjacency: two base faces are neighbors if they share two vertices
+	for (FaceId face = 0; face < baseFaceVertices.size(); ++face) {
+		for (unsigned int side = 0; side < 3; ++side) {
+			const unsigned int first = baseFaceVertices[face][(side + 1) % 3];
+			const unsigned int second = baseFaceVertices[face][(side + 2) % 3];
+
+			for (FaceId other = 0; other < baseFaceVertices.size(); ++other) {
+				if (other == face)
+					continue;
+				const auto& otherVertices = baseFaceVertices[other];
+				const auto firstIt = std::find(otherVertices.begin(), otherVertices.end(), first);
+				const auto secondIt = std::find(otherVertices.begin(), otherVertices.end(), second);
+				if (firstIt == otherVertices.end() || secondIt == otherVertices.end())
+					continue;
+
+				BaseNeighbor& neighbor = this->baseNeighbors[face][side];
+				neighbor.face = other;
+				neighbor.cornerMap[(side + 1) % 3] = static_cast<std::uint8_t>(firstIt - otherVertices.begin());
+				neighbor.cornerMap[(side + 2) % 3] = static_cast<std::uint8_t>(secondIt - otherVertices.begin());
+				break;
+			}
+		}
+	}
+}
+
+FaceId FaceLattice::neighborOf(const FaceId id, const unsigned int edge) const {
+	return this->neighborOf(faceid::baseFaceOf(id), faceid::levelOf(id), VertexNumbering::cornersOf(id), edge);
+}
+
+std::array<FaceId, 3> FaceLattice::neighborsOf(const FaceId id) const {
+	const FaceId baseFace = faceid::baseFaceOf(id);
+	const unsigned int level = faceid::levelOf(id);
+	const std::array<LatticePoint, 3> corners = VertexNumbering::cornersOf(id);
+	return {this->neighborOf(baseFace, level, corners, 0),
+		this->neighborOf(baseFace, level, corners, 1),
+		this->neighborOf(baseFace, level, corners, 2)};
+}
+
+FaceId FaceLattice::neighborOf(const FaceId baseFace, const unsigned int level,
+	const std::array<LatticePoint, 3>& corners, const unsigned int edge) const {
+	const LatticePoint& from = corners[edge % 3];
+	const LatticePoint& to = corners[(edge + 1) % 3];
+	const LatticePoint& opposite = corners[(edge + 2) % 3];
+
+	/// An edge on a side of the base face has a zero coordinate at both ends
+	for (unsigned int side = 0; side < 3; ++side) {
+		if (from[side] != 0 || to[side] != 0)
+			continue;
+
+		/// Carry the edge over into the adjacent base face, the triangle on the
+		/// inner side of it has the smaller coordinates along the side and 1 opposite
+		const BaseNeighbor& neighbor = this->baseNeighbors[baseFace][side];
+		std::array<LatticePoint, 3> triangle{};
+		for (const unsigned int corner : {(side + 1) % 3, (side + 2) % 3}) {
+			const unsigned int mapped = neighbor.cornerMap[corner];
+			triangle[0][mapped] = from[corner];
+			triangle[1][mapped] = to[corner];
+			triangle[2][mapped] = std::min(from[corner], to[corner]);
+		}
+		const unsigned int mappedSide = 3 - neighbor.cornerMap[(side + 1) % 3] - neighbor.cornerMap[(side + 2) % 3];
+		triangle[2][mappedSide] = 1;
+		return faceAt(neighbor.face, level, triangle);
+	}
+
+	/// Inside the base face: mirror the opposite corner at the edge
+	const LatticePoint mirrored = {from.a + to.a - opposite.a, from.b + to.b - opposite.b, from.c + to.c - opposite.c};
+	return faceAt(baseFace, level, {from, to, mirrored});
+}
+
+FaceId FaceLattice::faceAt(const FaceId baseFace, const unsigned int level, const std::array<LatticePoint, 3>& triangle) {
+	/// Descend towards the centroid of the triangle. The corner sum is three times the
+	/// centroid, so on depth d one lattice unit is scale = 3 * 2^(level - d) of it.
+	const LatticePoint centroid = triangle[0] + triangle[1] + triangle[2];
+	std::array<LatticePoint, 3> corners = VertexNumbering::baseCorners();
+	FaceId path = 0;
+
+	for (unsigned int depth = 0; depth < level; ++depth) {
+		const std::int64_t scale = std::int64_t{3} << (level - depth);
+
+		/// The corner child k contains the centroid if its barycentric weight for corner k
+		/// is above one half. Corner k differs from the other two in exactly one coordinate,
+		/// the weight is the distance along it.
+		unsigned int slot = 3;
+		for (unsigned int corner = 0; corner < 3 && slot == 3; ++corner) {
+			const LatticePoint& own = corners[corner];
+			const LatticePoint& other = corners[(corner + 1) % 3];
+			const LatticePoint& last = corners[(corner + 2) % 3];
+			for (unsigned int axis = 0; axis < 3; ++axis) {
+				if (other[axis] != last[axis] || own[axis] == other[axis])
+					continue;
+				const std::int64_t direction = own[axis] > other[axis] ? 1 : -1;
+				const std::int64_t distance = static_cast<std::int64_t>(centroid[axis])
+					- static_cast<std::int64_t>(other[axis]) * scale;
+				if (2 * distance * direction > scale)
+					slot = corner;
+				break;
+			}
+		}
+
+		path = (path << 2) | slot;
+		corners = VertexNumbering::childCorners(corners, slot);
+	}
+	return faceid::makeFaceId(baseFace, level, path);
+}
+} /// namespace lillugsi::planet
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "faceid.h"
+#include "vertexnumbering.h"
+#include <array>
+#include <cstdint>
+
+namespace lillugsi::planet {
+/// Face adjacency of the subdivided icosahedron, computed from lattice positions.
+/// Inside a base face the neighbor across an edge is the lattice triangle on the
+/// other side; across a base edge the edge is carried over into the adjacent base
+/// face with the icosahedral adjacency table. Both need O(level) integer steps,
+/// no sorting and no stored links.
+class FaceLattice {
+public:
+	FaceLattice() = default;
+	/// Base face vertices in their stored order, indices 0-11
+	explicit FaceLattice(const std::array<std::array<unsigned int, 3>, 20>& baseFaceVertices);
+
+	/// Neighbor across the edge from vertex edge to vertex edge + 1 of the face
+	[[nodiscard]] FaceId neighborOf(FaceId id, unsigned int edge) const;
+	[[nodiscard]] std::array<FaceId, 3> neighborsOf(FaceId id) const;
+	/// Same, for callers that already know the lattice corners of the face
+	[[nodiscard]] FaceId neighborOf(FaceId baseFace, unsigned int level,
+		const std::array<LatticePoint, 3>& corners, unsigned int edge) const;
+
+	/// FaceId of the lattice triangle with these corners (in any order) on the given level
+	[[nodiscard]] static FaceId faceAt(FaceId baseFace, unsigned int level, const std::array<LatticePoint, 3>& triangle);
+
+private:
+	/// The base face across a side of a base face. Side n lies opposite corner n,
+	/// cornerMap[k] is the corner of the neighbor at the vertex of our corner k (3 for corner n).
+	struct BaseNeighbor {
+		FaceId face{InvalidFaceId};
+		std::array<std::uint8_t, 3> cornerMap{{3, 3, 3}};
+	};
+
+	std::array<std::array<BaseNeighbor, 3>, 20> baseNeighbors{};
+};
+} /// namespace lillugsi::planet
@@ -0,0 +1,78 @@
+#include "faceneighborhood.h"
+
+#include <algorithm> /// For std::max
+#include <bit> /// For std::bit_ceil
+
+namespace lillugsi::planet {
+namespace {
+/// Multiplicative hash, the ids of a ring are close to each other
+std::size_t slotOf(const FaceId id, const std::size_t mask) {
+	return (static_cast<std::size_t>(id) * 0x9E3779B1u) & mask;
+}
+} /// namespace
+
+std::span<const FaceId> FaceNeighborhood::kRing(const FaceId id, const unsigned int k, const Adjacency adjacency) {
+	this->result.clear();
+	this->ringOffsets.clear();
+	if (id >= this->faces.size())
+		return {};
+
+	/// A vertex ring r holds about 12 r faces, an edge ring fewer
+	const std::size_t expectedCount = 1 + 6 * std::size_t{k} * (k + 1);
+	this->clearSeen(expectedCount);
+	this->result.reserve(expectedCount);
+
+	this->insert(id);
+	this->ringOffsets.push_back(0);
+	for (unsigned int ring = 0; ring < k; ++ring) {
+		const std::size_t begin = this->ringOffsets.back();
+		const std::size_t end = this->result.size();
+		this->ringOffsets.push_back(end);
+		for (std::size_t index = begin; index < end; ++index) {
+			const FaceId face = this->result[index];
+			if (adjacency == Adjacency::Edge) {
+				for (const FaceId neighbor : this->faces[face].neighbors) {
+					if (neighbor != InvalidFaceId)
+						this->insert(neighbor);
+				}
+			} else {
+				this->forEachVertexNeighbor(face, [this](const FaceId neighbor) { this->insert(neighbor); });
+			}
+		}
+	}
+	this->ringOffsets.push_back(this->result.size());
+	return this->result;
+}
+
+bool FaceNeighborhood::insert(const FaceId id) {
+	/// Keep the set at most half full
+	if (2 * (this->result.size() + 1) > this->seen.size()) {
+		this->clearSeen(2 * this->result.size() + 2);
+		for (const FaceId old : this->result) {
+			std::size_t slot = slotOf(old, this->seen.size() - 1);
+			while (this->seen[slot] != InvalidFaceId) {
+				slot = (slot + 1) & (this->seen.size() - 1);
+			}
+			this->seen[slot] = old;
+		}
+	}
+
+	const std::size_t mask = this->seen.size() - 1;
+	for (std::size_t slot = slotOf(id, mask);; slot = (slot + 1) & mask) {
+		if (this->seen[slot] == id)
+			return false;
+		if (this->seen[slot] == InvalidFaceId) {
+			this->seen[slot] = id;
+			this->result.push_back(id);
+			return true;
+		}
+	}
+}
+
+void FaceNeighborhood::clearSeen(const std::size_t expectedCount) {
+	const std::size_t size = std::bit_ceil(std::max<std::size_t>(2 * expectedCount, 64));
+	/// Shrinking keeps the capacity: only the part in use is cleared, and only a k
+	/// larger than any before allocates
+	this->seen.assign(size, InvalidFaceId);
+}
+} /// namespace lillugsi::planet
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "faceid.h"
+#include "facestore.h"
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace lillugsi::planet {
+/// Which faces are one hop apart
+enum class Adjacency {
+	Edge,  /// Faces sharing an edge, three per face
+	Vertex /// Faces sharing at least one vertex, twelve per face (nine next to the twelve base vertices)
+};
+
+/// k-ring enumeration over the neighbor links of a FaceStore.
+/// Breadth first over compact FaceIds of one level, deduplicated with an open
+/// addressing set. The result, the ring offsets and the set are members that are
+/// reused, so once they have grown to the largest k asked for a query allocates
+/// nothing. Not thread safe, use one FaceNeighborhood per thread.
+class FaceNeighborhood {
+public:
+	explicit FaceNeighborhood(const FaceStore& faces) : faces(faces) {}
+
+	/// All faces within k hops of id on its level, ring by ring with id first and
+	/// without duplicates. The span is valid until the next call.
+	std::span<const FaceId> kRing(FaceId id, unsigned int k, Adjacency adjacency = Adjacency::Vertex);
+	/// Ring r of the last kRing result is [offsets[r], offsets[r + 1]), r in 0 .. k
+	[[nodiscard]] std::span<const std::size_t> getRingOffsets() const { return this->ringOffsets; }
+
+	/// Calls function(neighbor) for every face sharing a vertex but not the face itself,
+	/// walking around each corner through the edge links
+	template <typename Function>
+	void forEachVertexNeighbor(FaceId id, Function&& function) const;
+
+private:
+	/// Adds the face unless it was seen, returns whether it was new
+	bool insert(FaceId id);
+	void clearSeen(std::size_t expectedCount);
+
+	const FaceStore& faces;
+	std::vector<FaceId> result;
+	std::vector<std::size_t> ringOffsets;
+	std::vector<FaceId> seen; /// Open addressing, a power of two in size, InvalidFaceId marks a free slot
+};
+
+template <typename Function>
+void FaceNeighborhood::forEachVertexNeighbor(const FaceId id, Function&& function) const {
+	const FlatFace& face = this->faces[id];
+	for (unsigned int corner = 0; corner < 3; ++corner) {
+		/// Rotate around the vertex, entering each face through one of its edges at
+		/// the vertex and leaving through the other. Five or six faces meet at a vertex,
+		/// the edge neighbors are reported too, except the one closing the loop.
+		const unsigned int vertex = face.vertexIndices[corner];
+		FaceId previous = id;
+		FaceId current = face.neighbors[(corner + 2) % 3];
+		for (unsigned int step = 0; step < 6 && current != id && current != InvalidFaceId; ++step) {
+			const FlatFace& next = this->faces[current];
+			const unsigned int at = next.vertexIndices[0] == vertex ? 0 : (next.vertexIndices[1] == vertex ? 1 : 2);
+			/// Edge at is the one from the vertex, edge at + 2 the one into it
+			const FaceId forward = next.neighbors[at] == previous ? next.neighbors[(at + 2) % 3] : next.neighbors[at];
+			/// The last face around this corner is the first one around the next corner
+			if (forward != id)
+				function(current);
+			previous = current;
+			current = forward;
+		}
+	}
+}
+} /// namespace lillugsi::planet
@@ -0,0 +1,153 @@
+#include "facequery.h"
+
+#include <algorithm> /// For std::min, std::max, std::clamp and std::sort
+#include <array>
+#include <cmath>
+#include <utility>
+
+namespace lillugsi::planet {
+namespace {
+/// Slack for the rounding of vertex positions and dot products
+constexpr float Tolerance = 1e-6f;
+
+enum class Overlap {
+	Outside,
+	Border,
+	Inside
+};
+
+/// Bounding cap of a face: the centroid direction and the cosine and sine of the cap angle
+struct FaceCap {
+	Vector3 center;
+	float cosAngle;
+	float sinAngle;
+};
+
+FaceCap capOf(const FaceId id, const VertexBuffer& vertices, const FaceStore& faces) {
+	const auto& vertexIndices = faces[id].vertexIndices;
+	const Vector3 a = vertices[vertexIndices[0]];
+	const Vector3 b = vertices[vertexIndices[1]];
+	const Vector3 c = vertices[vertexIndices[2]];
+	const Vector3 center = (a + b + c).normalized();
+	const float cosAngle = std::min({center.dot(a.normalized()), center.dot(b.normalized()),
+		center.dot(c.normalized())}) - Tolerance;
+	return {center, cosAngle, std::sqrt(std::max(0.0f, 1.0f - cosAngle * cosAngle))};
+}
+
+/// Two caps of angles r (the half space) and f (the face) with centers theta apart
+/// are disjoint if theta > r + f and nested if theta + f <= r. Compared as cosines,
+/// cos(r +- f) = cos r cos f -+ sin r sin f.
+Overlap classify(const SphericalRegion& region, const FaceCap& cap) {
+	Overlap result = Overlap::Inside;
+	for (const HalfSpace& halfSpace : region.getHalfSpaces()) {
+		const float cosRegion = std::clamp(halfSpace.minDot, -1.0f, 1.0f);
+		const float sinRegion = std::sqrt(1.0f - cosRegion * cosRegion);
+		const float cosTheta = halfSpace.normal.dot(cap.center);
+
+		/// r + f < pi, otherwise the caps always meet
+		const bool sumBelowPi = sinRegion * cap.cosAngle + cosRegion * cap.sinAngle > 0.0f;
+		if (sumBelowPi && cosTheta < cosRegion * cap.cosAngle - sinRegion * cap.sinAngle - Tolerance)
+			return Overlap::Outside;
+		const bool regionWider = cosRegion <= cap.cosAngle;
+		if (!regionWider || cosTheta < cosRegion * cap.cosAngle + sinRegion * cap.sinAngle + Tolerance)
+			result = Overlap::Border;
+	}
+	return result;
+}
+} /// namespace
+
+std::size_t FaceQuery::findFaces(const SphericalRegion& region, unsigned int level,
+	const VertexBuffer& vertices, const FaceStore& faces, const std::span<FaceId> faceIds) {
+	if (faces.getLevelCount() == 0)
+		return 0;
+	level = std::min(level, faces.getLevelCount() - 1);
+
+	std::size_t count = 0;
+	const auto output = [&](const FaceId first, const std::size_t faceCount) {
+		const std::size_t written = std::min(faceCount, faceIds.size() - std::min(count, faceIds.size()));
+		for (std::size_t index = 0; index < written; ++index) {
+			faceIds[count + index] = first + static_cast<FaceId>(index);
+		}
+		count += faceCount;
+	};
+
+	/// Depth first with an explicit stack: at most three pending siblings per level plus the base faces
+	std::array<FaceId, 20 + 3 * faceid::MaxLevel + 4> stack{};
+	std::size_t stackSize = 0;
+	for (FaceId baseFace = 20; baseFace-- > 0;) {
+		stack[stackSize++] = baseFace;
+	}
+	while (stackSize > 0) {
+		const FaceId id = stack[--stackSize];
+		const Overlap overlap = classify(region, capOf(id, vertices, faces));
+		if (overlap == Overlap::Outside)
+			continue;
+
+		const unsigned int faceLevel = faceid::levelOf(id);
+		if (overlap == Overlap::Inside || faceLevel == level) {
+			/// All descendants on the query level, one FaceId range
+			const unsigned int shift = 2 * (level - faceLevel);
+			const FaceId local = id - faceid::levelOffset(faceLevel);
+			output(faceid::levelOffset(level) + (local << shift), std::size_t{1} << shift);
+			continue;
+		}
+		const FaceId firstChild = faceid::levelOffset(faceLevel + 1) + 4 * (id - faceid::levelOffset(faceLevel));
+		for (FaceId slot = 4; slot-- > 0;) {
+			stack[stackSize++] = firstChild + slot;
+		}
+	}
+	return count;
+}
+
+FaceId FaceQuery::findNearestFace(const Vector3& point, unsigned int level,
+	const VertexBuffer& vertices, const FaceStore& faces) {
+	const Vector3 target = point.normalized();
+	if (faces.getLevelCount() == 0 || target.dot(target) == 0.0f)
+		return InvalidFaceId;
+	level = std::min(level, faces.getLevelCount() - 1);
+
+	/// Largest dot product of the target with any direction in the cap, cos(max(0, theta - f))
+	const auto upperBound = [&target](const FaceCap& cap) {
+		const float cosTheta = target.dot(cap.center);
+		if (cosTheta >= cap.cosAngle)
+			return 1.0f;
+		const float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+		return cosTheta * cap.cosAngle + sinTheta * cap.sinAngle + Tolerance;
+	};
+
+	FaceId best = InvalidFaceId;
+	float bestDot = -2.0f;
+	/// Same stack bound as findFaces, the children go on sorted so the closest is searched first
+	std::array<FaceId, 20 + 3 * faceid::MaxLevel + 4> stack{};
+	std::size_t stackSize = 0;
+	const auto pushSorted = [&](const FaceId first, const FaceId count) {
+		std::array<std::pair<float, FaceId>, 20> candidates{};
+		for (FaceId index = 0; index < count; ++index) {
+			candidates[index] = {target.dot(capOf(first + index, vertices, faces).center), first + index};
+		}
+		std::sort(candidates.begin(), candidates.begin() + count);
+		for (FaceId index = 0; index < count; ++index) {
+			stack[stackSize++] = candidates[index].second;
+		}
+	};
+
+	pushSorted(0, 20);
+	while (stackSize > 0) {
+		const FaceId id = stack[--stackSize];
+		const FaceCap cap = capOf(id, vertices, faces);
+		const unsigned int faceLevel = faceid::levelOf(id);
+		if (faceLevel == level) {
+			const float dot = target.dot(cap.center);
+			if (dot > bestDot || (dot == bestDot && id < best)) {
+				best = id;
+				bestDot = dot;
+			}
+			continue;
+		}
+		if (upperBound(cap) < bestDot)
+			continue;
+		pushSorted(faceid::levelOffset(faceLevel + 1) + 4 * (id - faceid::levelOffset(faceLevel)), 4);
+	}
+	return best;
+}
+} /// namespace lillugsi::planet
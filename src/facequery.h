@@ -0,0 +1,36 @@
+#pragma once
+
+#include "faceid.h"
+#include "vertexbuffer.h"
+#include "facestore.h"
+#include "sphericalregion.h"
+#include <span>
+
+namespace lillugsi::planet {
+/// Spatial queries over the face hierarchy.
+/// findFaces culls top-down: every face is bounded by the smallest cap around the
+/// direction of its centroid that holds its corners. Since the children of a face
+/// tile its spherical triangle, a face outside the region is skipped with its whole
+/// subtree, and a face inside it yields its descendants on the query level as one
+/// contiguous FaceId range without further tests. Only faces on the region border
+/// are descended, so the cost follows the output size.
+/// findNearestFace uses the same caps as bounds for a branch and bound search.
+class FaceQuery {
+public:
+	/// Faces of the level (clamped to the deepest stored level) that intersect the region,
+	/// in depth-first order. Faces on the border are kept if their bounding cap reaches
+	/// into every half space of the region, so a few faces that only come close may be
+	/// included, but none that intersect are missed.
+	/// Writes the first min(count, faceIds.size()) faces and returns the full count,
+	/// a caller with a short buffer can grow it and ask again.
+	[[nodiscard]] static std::size_t findFaces(const SphericalRegion& region, unsigned int level,
+		const VertexBuffer& vertices, const FaceStore& faces, std::span<FaceId> faceIds);
+
+	/// Face of the level (clamped to the deepest stored level) whose centroid direction
+	/// is closest in angle to the point, the nearest per-face sample. Children are
+	/// searched closest first, subtrees whose cap cannot beat the best face so far are
+	/// skipped. InvalidFaceId for the zero vector.
+	[[nodiscard]] static FaceId findNearestFace(const Vector3& point, unsigned int level,
+		const VertexBuffer& vertices, const FaceStore& faces);
+};
+} /// namespace lillugsi::planet
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "facechannel.h"
+#include "parallel.h"
+#include <algorithm>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace lillugsi::planet {
+/// Reducers combine the values of the four children (slots 0-3) into the parent value
+namespace reducers {
+struct Sum {
+	template <typename T>
+	T operator()(const T& a, const T& b, const T& c, const T& d) const { return a + b + c + d; }
+};
+/// The children of a face have about the same area, so the mean of the four
+/// child means is the mean over all leaves below
+struct Mean {
+	template <typename T>
+	T operator()(const T& a, const T& b, const T& c, const T& d) const { return (a + b + c + d) / T(4); }
+};
+struct Min {
+	template <typename T>
+	T operator()(const T& a, const T& b, const T& c, const T& d) const { return std::min({a, b, c, d}); }
+};
+struct Max {
+	template <typename T>
+	T operator()(const T& a, const T& b, const T& c, const T& d) const { return std::max({a, b, c, d}); }
+};
+} /// namespace reducers
+
+/// Bottom-up aggregation of a FaceChannel: every face above the leaf level holds
+/// the reduction of its four children, which turns the channel into a spherical
+/// mip pyramid. Coarse queries read a coarse level and never touch the leaves.
+/// Reducer is any callable T(const T&, const T&, const T&, const T&), for
+/// example one of the reducers above or a lambda.
+template <typename T, typename Reducer>
+class FaceReduction {
+public:
+	explicit FaceReduction(FaceChannel<T>& channel, Reducer reducer = Reducer{})
+	: channel(channel), reducer(std::move(reducer)) {}
+
+	/// Recomputes every level from the leaves up, each level split across threadCount threads
+	void reduceAll(const unsigned int threadCount = 1) {
+		const unsigned int levelCount = this->channel.getLevelCount();
+		for (unsigned int level = levelCount > 1 ? levelCount - 1 : 0; level-- > 0;) {
+			parallelForRanges(faceid::levelOffset(level), faceid::levelOffset(level + 1), threadCount,
+				[this, level](const FaceId begin, const FaceId end) {
+					for (FaceId id = begin; id < end; ++id) {
+						this->reduceFace(level, id);
+					}
+				});
+		}
+	}
+
+	/// After a change of one face, recomputes its ancestor chain only, O(level)
+	void update(const FaceId id) {
+		unsigned int level = faceid::levelOf(id);
+		FaceId local = id - faceid::levelOffset(level);
+		while (level > 0) {
+			--level;
+			local >>= 2;
+			this->reduceFace(level, faceid::levelOffset(level) + local);
+		}
+	}
+
+	/// After changes of many faces: every affected ancestor is recomputed once,
+	/// deepest level first, each level split across threadCount threads
+	void update(const std::span<const FaceId> ids, const unsigned int threadCount = 1) {
+		std::vector<std::vector<FaceId>> ancestors(this->channel.getLevelCount());
+		for (const FaceId id : ids) {
+			unsigned int level = faceid::levelOf(id);
+			FaceId local = id - faceid::levelOffset(level);
+			while (level > 0) {
+				--level;
+				local >>= 2;
+				ancestors[level].push_back(faceid::levelOffset(level) + local);
+			}
+		}
+		for (unsigned int level = static_cast<unsigned int>(ancestors.size()); level-- > 0;) {
+			std::vector<FaceId>& faces = ancestors[level];
+			std::sort(faces.begin(), faces.end());
+			faces.erase(std::unique(faces.begin(), faces.end()), faces.end());
+			parallelForRanges(std::size_t{0}, faces.size(), threadCount,
+				[this, level, &faces](const std::size_t begin, const std::size_t end) {
+					for (std::size_t index = begin; index < end; ++index) {
+						this->reduceFace(level, faces[index]);
+					}
+				});
+		}
+	}
+
+	[[nodiscard]] FaceChannel<T>& getChannel() { return this->channel; }
+
+private:
+	void reduceFace(const unsigned int level, const FaceId id) {
+		const FaceId first = faceid::levelOffset(level + 1) + 4 * (id - faceid::levelOffset(level));
+		this->channel[id] = this->reducer(this->channel[first], this->channel[first + 1],
+			this->channel[first + 2], this->channel[first + 3]);
+	}
+
+	FaceChannel<T>& channel;
+	Reducer reducer;
+};
+} /// namespace lillugsi::planet
@@ -0,0 +1,98 @@
+#include "facestore.h"
+#include "log.h"
+
+#include <algorithm> /// For std::min
+#include <cstddef>
+
+namespace lillugsi::planet {
+std::ostream& operator<<(std::ostream& os, const FlatFace& face) {
+	os << "Face(Vertices: [";
+	for (size_t i = 0; i < face.vertexIndices.size(); ++i) {
+		os << face.vertexIndices[i];
+		if (i < face.vertexIndices.size() - 1) os << ", ";
+	}
+	os << "], Data: " << face.data << ")";
+	return os;
+}
+
+void FaceStore::setLevelCount(const unsigned int levelCount) {
+	/// The layout of a level does not depend on the level count, so existing faces stay in place
+	this->levelCount = std::min(levelCount, faceid::MaxLevel + 1);
+	this->faces.resize(faceid::levelOffset(this->levelCount));
+}
+
+void FaceStore::clear() {
+	this->faces.clear();
+	this->levelCount = 0;
+}
+
+void FaceStore::setFace(const FaceId id, const std::array<unsigned int, 3>& vertexIndices) {
+	this->faces[id].vertexIndices = vertexIndices;
+}
+
+FaceId FaceStore::getLevelBegin(const unsigned int level) const {
+	return faceid::levelOffset(level);
+}
+
+FaceId FaceStore::getLevelEnd(const unsigned int level) const {
+	return faceid::levelOffset(level + 1);
+}
+
+unsigned int FaceStore::getLevel(const FaceId id) const {
+	return faceid::levelOf(id);
+}
+
+FaceId FaceStore::getParent(const FaceId id) const {
+	return faceid::parentOf(id);
+}
+
+FaceId FaceStore::getChild(const FaceId id, const unsigned int index) const {
+	if (this->isLeaf(id))
+		return InvalidFaceId;
+	return faceid::childOf(id, index);
+}
+
+std::array<FaceId, 4> FaceStore::getChildren(const FaceId id) const {
+	return {this->getChild(id, 0), this->getChild(id, 1), this->getChild(id, 2), this->getChild(id, 3)};
+}
+
+bool FaceStore::isLeaf(const FaceId id) const {
+	return faceid::levelOf(id) + 1 >= this->levelCount;
+}
+
+FaceId FaceStore::getNeighbor(const FaceId id, const unsigned int index) const {
+	if (index < 3)
+		return this->faces[id].neighbors[index];
+	return InvalidFaceId;
+}
+
+void FaceStore::setNeighbor(const FaceId id, const unsigned int index, const FaceId neighbor) {
+	if (index < 3)
+		this->faces[id].neighbors[index] = neighbor;
+}
+
+void FaceStore::addNeighbor(const FaceId id, const FaceId neighbor) {
+	auto& neighbors = this->faces[id].neighbors;
+	for (const FaceId existing : neighbors) {
+		if (existing == neighbor) {
+			LOG_DEBUG("addNeighbor: neighbor already exists");
+			return;
+		}
+	}
+
+	for (FaceId& slot : neighbors) {
+		if (slot == InvalidFaceId) {
+			slot = neighbor;
+			return;
+		}
+	}
+}
+
+void FaceStore::setData(const FaceId id, const float value) {
+	this->faces[id].data = value;
+}
+
+float FaceStore::getData(const FaceId id) const {
+	return this->faces[id].data;
+}
+} /// namespace lillugsi::planet
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "faceid.h"
+#include <array>
+#include <vector>
+#include <iostream>
+
+namespace lillugsi::planet {
+/// Compact face record of the flat storage mode.
+/// Parent and children follow from the FaceId (see faceid.h) and are not stored,
+/// neighbors are FaceIds into the same FaceStore.
+/// sizeof(FlatFace) is 28 bytes, compared to 176 bytes for a Face node
+/// (144 bytes object + shared_ptr control block, see FaceArena).
+struct FlatFace {
+	std::array<unsigned int, 3> vertexIndices{{0, 0, 0}};
+	std::array<FaceId, 3> neighbors{{InvalidFaceId, InvalidFaceId, InvalidFaceId}};
+	float data{0.0f};
+};
+
+std::ostream& operator<<(std::ostream& os, const FlatFace& face);
+
+/// Faces of all subdivision levels in one contiguous array, in the
+/// implicit layout of faceid.h. Level n occupies the FaceId range
+/// [getLevelBegin(n), getLevelEnd(n)), every level is four times the size
+/// of the one above.
+class FaceStore {
+public:
+	FaceStore() = default;
+
+	/// Resizes the storage to hold the levels 0 .. levelCount - 1,
+	/// already stored faces keep their FaceIds
+	void setLevelCount(unsigned int levelCount);
+	void clear();
+
+	/// Stores the vertices of a face, the id determines its place in the hierarchy
+	void setFace(FaceId id, const std::array<unsigned int, 3>& vertexIndices);
+
+	/// Accessors
+	[[nodiscard]] FlatFace& operator[](FaceId id) { return this->faces[id]; }
+	[[nodiscard]] const FlatFace& operator[](FaceId id) const { return this->faces[id]; }
+	[[nodiscard]] FaceId size() const { return static_cast<FaceId>(this->faces.size()); }
+	[[nodiscard]] unsigned int getLevelCount() const { return this->levelCount; }
+	[[nodiscard]] FaceId getLevelBegin(unsigned int level) const;
+	[[nodiscard]] FaceId getLevelEnd(unsigned int level) const;
+	[[nodiscard]] unsigned int getLevel(FaceId id) const;
+
+	/// Links
+	[[nodiscard]] FaceId getParent(FaceId id) const;
+	[[nodiscard]] FaceId getChild(FaceId id, unsigned int index) const;
+	[[nodiscard]] std::array<FaceId, 4> getChildren(FaceId id) const;
+	[[nodiscard]] bool isLeaf(FaceId id) const;
+	[[nodiscard]] FaceId getNeighbor(FaceId id, unsigned int index) const;
+	void setNeighbor(FaceId id, unsigned int index, FaceId neighbor);
+	void addNeighbor(FaceId id, FaceId neighbor);
+
+	/// Data
+	void setData(FaceId id, float value);
+	[[nodiscard]] float getData(FaceId id) const;
+
+	/// Storage cost of one face in bytes
+	static constexpr std::size_t BytesPerFace = sizeof(FlatFace);
+
+private:
+	std::vector<FlatFace> faces;
+	unsigned int levelCount{0};
+};
+} /// namespace lillugsi::planet
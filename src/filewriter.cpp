@@ -0,0 +1,38 @@
+#include "filewriter.h"
+
+#include <algorithm> /// For std::min
+#include <array>
+
+namespace lillugsi::planet {
+FileWriter::FileWriter(const std::string& path) : file(std::fopen(path.c_str(), "wb")) {
+	if (this->file)
+		std::setvbuf(this->file, nullptr, _IOFBF, 1 << 20);
+}
+
+FileWriter::~FileWriter() {
+	if (this->file)
+		std::fclose(this->file);
+}
+
+void FileWriter::write(const void* bytes, const std::size_t count) {
+	if (this->good && count > 0 && std::fwrite(bytes, 1, count, this->file) != count)
+		this->good = false;
+	this->position += count;
+}
+
+void FileWriter::padTo(const std::uint64_t offset) {
+	static constexpr std::array<char, 64> zeros{};
+	while (this->position < offset) {
+		this->write(zeros.data(), static_cast<std::size_t>(std::min<std::uint64_t>(zeros.size(), offset - this->position)));
+	}
+}
+
+bool FileWriter::finish() {
+	if (!this->file)
+		return false;
+	if (std::fclose(this->file) != 0)
+		this->good = false;
+	this->file = nullptr;
+	return this->good;
+}
+} /// namespace lillugsi::planet
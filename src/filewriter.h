@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace lillugsi::planet {
+/// std::FILE with a large buffer for the binary and text writers.
+/// Errors are sticky: after a failed write the rest is skipped and finish() returns false.
+class FileWriter {
+public:
+	explicit FileWriter(const std::string& path);
+	~FileWriter();
+	FileWriter(const FileWriter&) = delete;
+	FileWriter& operator=(const FileWriter&) = delete;
+
+	[[nodiscard]] bool isOpen() const { return this->file != nullptr; }
+	[[nodiscard]] std::uint64_t getPosition() const { return this->position; }
+
+	void write(const void* bytes, std::size_t count);
+	/// Writes zero bytes up to the offset
+	void padTo(std::uint64_t offset);
+
+	/// Flushes and closes, false if any write failed
+	bool finish();
+
+private:
+	std::FILE* file;
+	std::uint64_t position{0};
+	bool good{true};
+};
+} /// namespace lillugsi::planet
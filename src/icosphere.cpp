@@ -1,23 +1,38 @@
 #include "icosphere.h"
-#include "vector3.h"
 #include "datasettingvisitor.h"
-// #include "spdlog/spdlog.h"
+#include "spherefile.h"
+#include "parallel.h"
+#include "log.h"
 
 #include <algorithm> /// For std::min and std::max
-#include <map>
-#include <iostream>
+#include <cmath>
 
 namespace lillugsi::planet {
-Icosphere::Icosphere() {
+namespace {
+/// Bytes std::allocate_shared takes from the arena for one Face, control block included
+std::size_t faceNodeSize() {
+	static const std::size_t size = [] {
+		const auto arena = std::make_shared<FaceArena>();
+		const auto face = std::allocate_shared<Face>(FaceAllocator<Face>(arena), std::array<unsigned int, 3>{});
+		return arena->getAllocatedBytes();
+	}();
+	return size;
+}
+} /// namespace
+
+Icosphere::Icosphere(const FaceStorage storage)
+: storage(storage) {
 	this->initializeBaseIcosahedron();
 }
 
 
 Icosphere::~Icosphere() {
-	/// Cleanup if needed
+	/// Breaks the neighbor cycles, so the nodes nobody else holds are destroyed with treeFaces.
+	/// The arena goes with the last node, nodes still held outside keep it alive.
+	this->releaseTreeFaces(0);
 }
 
-Icosphere::Icosphere(const Icosphere& other) : vertices(other.vertices), indices(other.indices) {
+Icosphere::Icosphere(const Icosphere& other) : storage(other.storage), vertices(other.vertices), indices(other.indices) {
 	/// Copy constructor implementation
 }
 
@@ -30,13 +45,35 @@ Icosphere& Icosphere::operator=(const Icosphere& other) {
 }
 
 std::vector<Vector3> Icosphere::getVertices() const {
-	return vertices;
+	return this->vertices.toVector();
 }
 
 std::vector<unsigned int> Icosphere::getIndices() const {
 	return indices;
 }
 
+VertexView Icosphere::getLevelVertices(const unsigned int level) const {
+	if (level >= this->faces.getLevelCount())
+		return {};
+	return this->vertices.view(VertexNumbering::vertexCount(level));
+}
+
+std::span<const unsigned int> Icosphere::getLevelIndices(const unsigned int level) const {
+	if (level >= this->faces.getLevelCount())
+		return {};
+	const std::size_t begin = 3 * static_cast<std::size_t>(this->faces.getLevelBegin(level));
+	const std::size_t end = 3 * static_cast<std::size_t>(this->faces.getLevelEnd(level));
+	return std::span<const unsigned int>(this->indices).subspan(begin, end - begin);
+}
+
+VertexView Icosphere::getLeafVertices() const {
+	return this->getLevelVertices(this->faces.getLevelCount() - 1);
+}
+
+std::span<const unsigned int> Icosphere::getLeafIndices() const {
+	return this->getLevelIndices(this->faces.getLevelCount() - 1);
+}
+
 void Icosphere::applyVisitorToFace(const std::shared_ptr<Face> &face, FaceVisitor& visitor) {
 	if (!face) return;
 	
@@ -48,71 +85,281 @@ void Icosphere::applyVisitorToFace(const std::shared_ptr<Face> &face, FaceVisito
 	}
 }
 
-void Icosphere::applyVisitor(FaceVisitor& visitor) const {
-	for (auto& baseFace : this->baseFaces) {
-		applyVisitorToFace(baseFace, visitor);
+void Icosphere::applyVisitorToFace(FaceStore& faces, const FaceId id, FaceVisitor& visitor) {
+	if (id == InvalidFaceId) return;
+
+	visitor.visit(faces, id); // Apply the visitor to the current face
+
+	// Recursively apply the visitor to all children
+	for (const FaceId child : faces.getChildren(id)) {
+		applyVisitorToFace(faces, child, visitor);
 	}
 }
 
-std::shared_ptr<Face> Icosphere::getFaceAtPoint(const Vector3 &point) const {
-	Vector3 normalizedPoint = point.normalized() * 2.0f; /// normalized and multiplied by 2 should definitly intersect with a unit sphere
-	for (const auto& baseFace : baseFaces) {
-		auto result = getFaceAtPointRecursive(baseFace, normalizedPoint);
-		if (result)
-			return result;
+void Icosphere::applyVisitor(FaceVisitor& visitor) {
+	for (FaceId baseFace = 0; baseFace < this->faces.getLevelEnd(0); ++baseFace) {
+		if (this->storage == FaceStorage::Tree)
+			applyVisitorToFace(this->treeFaces[baseFace], visitor);
+		else
+			applyVisitorToFace(this->faces, baseFace, visitor);
 	}
-	return nullptr;
 }
 
-unsigned int Icosphere::addVertex(const Vector3 vertex) {
-	vertices.push_back(vertex);
-	// spdlog::debug("addVertex: {}", vertices.size() - 1);
-	/// Assuming the vertices vector is zero-indexed, the position of the newly added vertex
-	/// is at the size of the vector before the push_back minus 1.
-	return vertices.size() - 1;
-}
-
-std::shared_ptr<Face> Icosphere::addFace(const unsigned int v1, const unsigned int v2, const unsigned int v3) {
-	std::cout << "addFace(" << v1 << ", " << v2 << ", " << v3 <<")\n";
-	/// Adding indices for a triangular face
-	indices.push_back(v3);
-	indices.push_back(v2);
-	indices.push_back(v1);
-
-	/// Create and store the Face object
-	std::shared_ptr<Face> face = std::make_shared<Face>(std::array<unsigned int, 3>{v3, v2, v1});
+void Icosphere::applyVisitor(FaceVisitor& visitor, FaceChannel<float>& channel) {
+	const FaceId end = std::min<FaceId>(this->faces.size(), static_cast<FaceId>(channel.size()));
+	for (FaceId id = 0; id < end; ++id) {
+		visitor.visit(channel, id);
+	}
+}
+
+std::shared_ptr<Face> Icosphere::getFaceAtPoint(const Vector3 &point) const {
+	if (this->storage != FaceStorage::Tree)
+		return nullptr;
+
+	const FaceId id = this->getFaceIdAtPoint(point);
+	if (id == InvalidFaceId)
+		return nullptr;
+	return this->treeFaces[id];
+}
+
+FaceId Icosphere::getFaceIdAtPoint(const Vector3 &point) const {
+	return this->locate(point, this->faces.getLevelCount() - 1);
+}
+
+FaceId Icosphere::locate(const Vector3& point, const unsigned int level) const {
+	const stats::ScopedTimer timer(this->statsRecorder, stats::Phase::Locate);
+	this->statsRecorder.add(stats::Counter::PointLookups, 1);
+	stats::LocalCounts counts;
+	const FaceId face = this->locator.locate(point, level, this->vertices, this->faces, counts);
+	counts.flushTo(this->statsRecorder);
 	return face;
 }
 
-void Icosphere::subdivide(int levels) {
-	for (auto& baseFace : baseFaces) {
-		subdivideFace(baseFace, 0, levels);
+void Icosphere::locatePoints(const std::span<const Vector3> points, const std::span<FaceId> faceIds,
+	const unsigned int level, const unsigned int threadCount) const {
+	const stats::ScopedTimer timer(this->statsRecorder, stats::Phase::Locate);
+	this->statsRecorder.add(stats::Counter::PointLookups, std::min(points.size(), faceIds.size()));
+	this->locator.locatePoints(points, faceIds, level, this->vertices, this->faces, this->statsRecorder, threadCount);
+}
+
+std::size_t Icosphere::findFaces(const SphericalRegion& region, const unsigned int level,
+	const std::span<FaceId> faceIds) const {
+	return FaceQuery::findFaces(region, level, this->vertices, this->faces, faceIds);
+}
+
+FaceId Icosphere::findNearestFace(const Vector3& point, const unsigned int level) const {
+	return FaceQuery::findNearestFace(point, level, this->vertices, this->faces);
+}
+
+unsigned int Icosphere::addVertex(const Vector3 vertex) {
+	this->statsRecorder.add(stats::Counter::VerticesCreated, 1);
+	return this->vertices.add(vertex);
+}
+
+FaceId Icosphere::addFace(const FaceId id, const unsigned int v1, const unsigned int v2, const unsigned int v3) {
+	LOG_TRACE("addFace(", v1, ", ", v2, ", ", v3, ")");
+	/// Adding indices for a triangular face, the index buffer is laid out by FaceId
+	const std::size_t first = 3 * static_cast<std::size_t>(id);
+	indices[first] = v3;
+	indices[first + 1] = v2;
+	indices[first + 2] = v1;
+
+	/// Store the face record, its id already encodes parent and children
+	this->faces.setFace(id, {v3, v2, v1});
+
+	/// Tree mode: create the Face object and set the parent-child relationship
+	if (this->storage == FaceStorage::Tree) {
+		std::shared_ptr<Face> face = std::allocate_shared<Face>(FaceAllocator<Face>(this->faceArena),
+			std::array<unsigned int, 3>{v3, v2, v1});
+		const FaceId parent = faceid::parentOf(id);
+		if (parent != InvalidFaceId) {
+			face->setParent(this->treeFaces[parent]);
+			this->treeFaces[parent]->setChild(faceid::childSlotOf(id), face);
+		}
+		this->treeFaces[id] = std::move(face);
+	}
+	return id;
+}
+
+void Icosphere::subdivide(int levels, const unsigned int threadCount) {
+	const stats::ScopedTimer timer(this->statsRecorder, stats::Phase::Subdivide);
+	const unsigned int firstLevel = this->faces.getLevelCount() - 1;
+	const FaceId firstNewFace = this->faces.size();
+	const unsigned int targetLevel = this->prepareSubdivision(levels);
+
+	/// One pass per level over the contiguous face range of that level. Faces of a level
+	/// are independent: each writes only its own children and the midpoints it creates.
+	/// Levels of an earlier subdivide are kept, splitting starts at the current leaves.
+	for (unsigned int level = firstLevel; level < targetLevel; ++level) {
+		{
+			const stats::ScopedTimer splitTimer(this->statsRecorder, stats::Phase::SplitFaces);
+			parallelForRanges(this->faces.getLevelBegin(level), this->faces.getLevelEnd(level), threadCount,
+				[this, level](const FaceId begin, const FaceId end) {
+					this->subdivideLevel(level, begin, end);
+				});
+		}
+		this->computeMidpoints(level + 1, threadCount);
+		LOG_DEBUG("subdivide: level ", level + 1, " done, ", faceid::levelFaceCount(level + 1), " faces, ",
+			VertexNumbering::vertexCount(level + 1), " vertices");
 	}
 
+	this->firstParents = {};
+	this->secondParents = {};
+
 	/// After subdivision, we run a separate function
-	/// to recursively set neighbors for each face.
-	this->setNeighbors();
+	/// to set neighbors for each new face.
+	this->setNeighbors(firstNewFace, threadCount);
 }
 
-unsigned int Icosphere::getOrCreateMidpointIndex(unsigned int index1, unsigned int index2) {
-	/// Ensure the first index is always the smaller one to avoid duplicates
-	std::pair<int, int> key(std::min(index1, index2), std::max(index1, index2));
-	std::cout << "getOrCreateMidpointIndex(" << key.first << ", " << key.second << "): ";
+void Icosphere::subdivideRecursive(int levels) {
+	const stats::ScopedTimer timer(this->statsRecorder, stats::Phase::Subdivide);
+	const unsigned int firstLevel = this->faces.getLevelCount() - 1;
+	const FaceId firstNewFace = this->faces.size();
+	const unsigned int targetLevel = this->prepareSubdivision(levels);
+
+	{
+		const stats::ScopedTimer splitTimer(this->statsRecorder, stats::Phase::SplitFaces);
+		stats::LocalCounts counts;
+		for (FaceId baseFace = 0; baseFace < this->faces.getLevelEnd(0); ++baseFace) {
+			subdivideFace(baseFace, VertexNumbering::baseCorners(), 0, firstLevel, targetLevel, counts);
+		}
+		counts.flushTo(this->statsRecorder);
+	}
+	for (unsigned int level = firstLevel + 1; level <= targetLevel; ++level) {
+		this->computeMidpoints(level, 1);
+	}
+	this->firstParents = {};
+	this->secondParents = {};
+
+	this->setNeighbors(firstNewFace, 1);
+}
+
+bool Icosphere::load(const SphereFile& file) {
+	/// The analytic numbering and adjacency assume the base faces of initializeBaseIcosahedron
+	const std::span<const FlatFace> records = file.getFaces();
+	for (FaceId baseFace = 0; baseFace < this->faces.getLevelEnd(0); ++baseFace) {
+		if (records[baseFace].vertexIndices != this->faces[baseFace].vertexIndices) {
+			LOG_ERROR("load: base face ", baseFace, " of the sphere file differs from this build");
+			return false;
+		}
+	}
+
+	const unsigned int levelCount = file.getLevelCount();
+	/// A fresh arena, the old one goes with the last of its nodes
+	if (this->storage == FaceStorage::Tree) {
+		this->releaseTreeFaces(0);
+		this->faceArena = std::make_shared<FaceArena>();
+	}
+	this->faces.setLevelCount(levelCount);
+	std::copy(records.begin(), records.end(), &this->faces[0]);
+	this->channels.setLevelCount(levelCount);
+	this->vertices.assign(file.getVertices());
+	const std::span<const unsigned int> fileIndices = file.getIndices();
+	this->indices.assign(fileIndices.begin(), fileIndices.end());
+
+	/// Tree mode: one Face node per record, linked like addFace and setNeighbors do
+	if (this->storage == FaceStorage::Tree) {
+		this->faceArena->reserve(static_cast<std::size_t>(this->faces.size()) * faceNodeSize());
+		this->treeFaces.resize(this->faces.size());
+		for (FaceId id = 0; id < this->faces.size(); ++id) {
+			std::shared_ptr<Face> face = std::allocate_shared<Face>(FaceAllocator<Face>(this->faceArena),
+				this->faces[id].vertexIndices);
+			face->setData(this->faces[id].data);
+			const FaceId parent = faceid::parentOf(id);
+			if (parent != InvalidFaceId) {
+				face->setParent(this->treeFaces[parent]);
+				this->treeFaces[parent]->setChild(faceid::childSlotOf(id), face);
+			}
+			this->treeFaces[id] = std::move(face);
+		}
+		this->linkTreeNeighbors(0);
+	}
+	LOG_DEBUG("load: ", levelCount, " levels, ", this->faces.size(), " faces");
+	return true;
+}
 
-	/// Check if this midpoint has already been created
-	if (midpointIndexCache.find(key) != midpointIndexCache.end()) {
-		std::cout << "found key: " << midpointIndexCache[key] << std::endl;
-		return midpointIndexCache[key];
+unsigned int Icosphere::prepareSubdivision(int levels) {
+	if (levels > static_cast<int>(faceid::MaxLevel)) {
+		LOG_WARN("subdivide: limiting ", levels, " levels to ", faceid::MaxLevel);
+		levels = faceid::MaxLevel;
+	}
+	const auto targetLevel = static_cast<unsigned int>(std::max(levels, 0));
+
+	/// Face and vertex counts are known in advance (20 * 4^L faces and 10 * 4^L + 2 vertices
+	/// on level L), so every buffer is sized once. FaceIds of existing faces do not change,
+	/// fewer levels than before drop the deepest ones.
+	if (this->storage == FaceStorage::Tree && faceid::levelOffset(targetLevel + 1) < this->treeFaces.size())
+		this->releaseTreeFaces(faceid::levelOffset(targetLevel + 1));
+	this->faces.setLevelCount(targetLevel + 1);
+	this->channels.setLevelCount(targetLevel + 1);
+	this->indices.resize(3 * static_cast<std::size_t>(this->faces.size()));
+	this->vertices.resize(VertexNumbering::vertexCount(targetLevel));
+	this->firstParents.resize(this->vertices.size() - VertexNumbering::vertexCount(0));
+	this->secondParents.resize(this->firstParents.size());
+	if (this->storage == FaceStorage::Tree) {
+		/// One block for all new nodes, so the parallel levels only bump its offset
+		if (this->faces.size() > this->treeFaces.size())
+			this->faceArena->reserve((this->faces.size() - this->treeFaces.size()) * faceNodeSize());
+		this->treeFaces.resize(this->faces.size());
 	}
 
-	/// Create a new midpoint vertex, then normalize it to ensure it's on the unit sphere
-	Vector3 midpoint = (vertices[index1] + vertices[index2]) * 0.5f;
-	midpoint.normalize();
-	unsigned int midpointIndex = addVertex(midpoint);
-	std::cout << "add vertex: " << midpointIndex << std::endl;
+	return targetLevel;
+}
+
+void Icosphere::computeMidpoints(const unsigned int level, const unsigned int threadCount) {
+	const stats::ScopedTimer timer(this->statsRecorder, stats::Phase::ComputeMidpoints);
+	/// The vertices new on a level are contiguous and their parents all lie on earlier levels
+	const std::size_t begin = VertexNumbering::vertexCount(level - 1);
+	const std::size_t end = VertexNumbering::vertexCount(level);
+	this->statsRecorder.add(stats::Counter::VerticesCreated, end - begin);
+	const std::size_t baseCount = VertexNumbering::vertexCount(0);
+	parallelForRanges(begin, end, threadCount, [this, baseCount](const std::size_t first, const std::size_t last) {
+		this->vertices.setMidpoints(first, last,
+			this->firstParents.data() + (first - baseCount), this->secondParents.data() + (first - baseCount));
+	});
+}
 
-	/// Add to cache
-	midpointIndexCache[key] = midpointIndex;
+void Icosphere::subdivideLevel(const unsigned int level, const FaceId begin, const FaceId end) {
+	/// Walk the faces in path order like an odometer and keep the lattice corners of
+	/// every depth, only the depths below the lowest changed digit are recomputed,
+	/// on average 4/3 per face
+	std::array<std::array<LatticePoint, 3>, faceid::MaxLevel + 1> corners;
+	corners[0] = VertexNumbering::baseCorners();
+	const FaceId pathMask = (FaceId{1} << (2 * level)) - 1;
+	stats::LocalCounts counts;
+
+	for (FaceId face = begin; face < end; ++face) {
+		const FaceId path = (face - this->faces.getLevelBegin(level)) & pathMask;
+		unsigned int depth = 1;
+		if (face != begin && path != 0) {
+			unsigned int trailingZeros = 0;
+			while (((path >> trailingZeros) & 1u) == 0) {
+				++trailingZeros;
+			}
+			depth = level - trailingZeros / 2;
+		}
+		for (; depth <= level; ++depth) {
+			corners[depth] = VertexNumbering::childCorners(corners[depth - 1],
+				(path >> (2 * (level - depth))) & 3u);
+		}
+		this->splitFace(face, corners[level], false, counts);
+	}
+	counts.flushTo(this->statsRecorder);
+}
+
+unsigned int Icosphere::getMidpointIndex(const FaceId baseFace, const unsigned int level, const LatticePoint midpoint,
+	const unsigned int index1, const unsigned int index2, const bool create) {
+	/// The index follows from the lattice position, faces sharing the edge compute the same one
+	const unsigned int midpointIndex = this->vertexNumbering.vertexIndex(baseFace, level, midpoint);
+	LOG_TRACE("getMidpointIndex(", std::min(index1, index2), ", ", std::max(index1, index2), "): ", midpointIndex);
+
+	/// Record the edge, computeMidpoints turns it into the normalized midpoint.
+	/// Only one of the two faces of an edge writes it.
+	if (create) {
+		const std::size_t parent = midpointIndex - VertexNumbering::vertexCount(0);
+		this->firstParents[parent] = index1;
+		this->secondParents[parent] = index2;
+	}
 
 	return midpointIndex;
 }
@@ -120,7 +367,14 @@ unsigned int Icosphere::getOrCreateMidpointIndex(unsigned int index1, unsigned i
 void Icosphere::initializeBaseIcosahedron() {
 	this->vertices.clear();
 	this->indices.clear();
-	this->midpointIndexCache.clear();
+	this->faces.clear();
+	this->faces.setLevelCount(1);
+	this->channels.setLevelCount(1);
+	this->indices.resize(3 * static_cast<std::size_t>(this->faces.size()));
+	this->releaseTreeFaces(0);
+	this->faceArena = std::make_shared<FaceArena>();
+	if (this->storage == FaceStorage::Tree)
+		this->treeFaces.resize(this->faces.size());
 
 	float phi = (1.0f + sqrt(5.0f)) * 0.5f; /// golden ratio
 	float a = 1.0f;
@@ -141,255 +395,154 @@ void Icosphere::initializeBaseIcosahedron() {
 	this->addVertex(Vector3(-b, -a, 0).normalized()); // v11
 
 	/// Add faces
-	baseFaces.push_back(this->addFace(2, 1, 0));
-	baseFaces.push_back(this->addFace(2, 3, 1));
-	baseFaces.push_back(this->addFace(5, 4, 3));
-	baseFaces.push_back(this->addFace(4, 8, 3));
-	baseFaces.push_back(this->addFace(7, 6, 0));
-	baseFaces.push_back(this->addFace(6, 9, 0));
-	baseFaces.push_back(this->addFace(11, 10, 4));
-	baseFaces.push_back(this->addFace(10, 11, 6));
-	baseFaces.push_back(this->addFace(9, 5, 2));
-	baseFaces.push_back(this->addFace(5, 9, 11));
-	baseFaces.push_back(this->addFace(8, 7, 1));
-	baseFaces.push_back(this->addFace(7, 8, 10));
-	baseFaces.push_back(this->addFace(2, 5, 3));
-	baseFaces.push_back(this->addFace(8, 1, 3));
-	baseFaces.push_back(this->addFace(9, 2, 0));
-	baseFaces.push_back(this->addFace(1, 7, 0));
-	baseFaces.push_back(this->addFace(11, 9, 6));
-	baseFaces.push_back(this->addFace(7, 10, 6));
-	baseFaces.push_back(this->addFace(5, 11, 4));
-	baseFaces.push_back(this->addFace(10, 8, 4));
-}
-
-void Icosphere::subdivideFace(const std::shared_ptr<Face> &face, unsigned int currentLevel, unsigned int targetLevel) {
-	if (currentLevel >= targetLevel) {
-		return; /// Base case: Reached the desired level of subdivision
+	this->addFace(0, 2, 1, 0);
+	this->addFace(1, 2, 3, 1);
+	this->addFace(2, 5, 4, 3);
+	this->addFace(3, 4, 8, 3);
+	this->addFace(4, 7, 6, 0);
+	this->addFace(5, 6, 9, 0);
+	this->addFace(6, 11, 10, 4);
+	this->addFace(7, 10, 11, 6);
+	this->addFace(8, 9, 5, 2);
+	this->addFace(9, 5, 9, 11);
+	this->addFace(10, 8, 7, 1);
+	this->addFace(11, 7, 8, 10);
+	this->addFace(12, 2, 5, 3);
+	this->addFace(13, 8, 1, 3);
+	this->addFace(14, 9, 2, 0);
+	this->addFace(15, 1, 7, 0);
+	this->addFace(16, 11, 9, 6);
+	this->addFace(17, 7, 10, 6);
+	this->addFace(18, 5, 11, 4);
+	this->addFace(19, 10, 8, 4);
+	this->statsRecorder.add(stats::Counter::FacesCreated, 20);
+
+	std::array<std::array<unsigned int, 3>, 20> baseFaceVertices{};
+	for (FaceId baseFace = 0; baseFace < baseFaceVertices.size(); ++baseFace) {
+		baseFaceVertices[baseFace] = this->faces[baseFace].vertexIndices;
 	}
-	std::cout << "subdivideFace(" << face->getVertexIndices()[0] << ", "
-		<< face->getVertexIndices()[1] << ", "
-		<< face->getVertexIndices()[2] << "): " << currentLevel << " : " << targetLevel << std::endl;
-
-	/// Calculate midpoints and create new vertices (if necessary)
-	const unsigned int mid1 = getOrCreateMidpointIndex(face->getVertexIndices()[0], face->getVertexIndices()[1]);
-	const unsigned int mid2 = getOrCreateMidpointIndex(face->getVertexIndices()[1], face->getVertexIndices()[2]);
-	const unsigned int mid3 = getOrCreateMidpointIndex(face->getVertexIndices()[2], face->getVertexIndices()[0]);
-
-	/// Create new faces using the original vertices and the new midpoints
-	std::array<std::shared_ptr<Face>, 4> newFaces = {
-		this->addFace(face->getVertexIndices()[0], mid1, mid3),
-		this->addFace(mid1, face->getVertexIndices()[1], mid2),
-		this->addFace(mid3, mid2, face->getVertexIndices()[2]),
-		this->addFace(mid1, mid2, mid3)
-	};
+	this->vertexNumbering = VertexNumbering(baseFaceVertices);
+	this->lattice = FaceLattice(baseFaceVertices);
+	this->locator = PointLocator(this->vertices, this->faces);
 
-	/// Set parent-child relationships
-	for (auto& newFace : newFaces) {
-		newFace->setParent(face);
-		face->addChild(newFace);
-	}
-
-	/// Recursively subdivide the new faces
-	for (auto& newFace : newFaces) {
-		subdivideFace(newFace, currentLevel + 1, targetLevel);
-	}
+	/// subdivide only links the faces it creates, the base faces are linked here once
+	this->setNeighbors(0, 1);
 }
 
-void Icosphere::setNeighbors() {
-	this->setNeighborsForBaseFaces();
+std::array<FaceId, 4> Icosphere::splitFace(const FaceId face, const std::array<LatticePoint, 3>& corners,
+	const bool createAllMidpoints, stats::LocalCounts& counts) {
+	const std::array<unsigned int, 3> vertexIndices = this->faces[face].vertexIndices;
 
-	for (const auto& baseFace : this->baseFaces) {
-		for (const auto& face : baseFace->getChildren()) {
-			if (face)
-				this->setNeighborsForFace(face);
-			else
-				std::cout << "no child\n";
-		}
-	}
+	/// Calculate midpoints and create new vertices
+	const FaceId baseFace = faceid::baseFaceOf(face);
+	const unsigned int childLevel = faceid::levelOf(face) + 1;
+	const auto creates = [&](const unsigned int corner) {
+		return createAllMidpoints || this->vertexNumbering.createsMidpoint(baseFace, corners, corner);
+	};
+	const std::array<bool, 3> created = {creates(0), creates(1), creates(2)};
+	const unsigned int mid1 = getMidpointIndex(baseFace, childLevel, corners[0] + corners[1],
+		vertexIndices[0], vertexIndices[1], created[0]);
+	const unsigned int mid2 = getMidpointIndex(baseFace, childLevel, corners[1] + corners[2],
+		vertexIndices[1], vertexIndices[2], created[1]);
+	const unsigned int mid3 = getMidpointIndex(baseFace, childLevel, corners[2] + corners[0],
+		vertexIndices[2], vertexIndices[0], created[2]);
+	const unsigned int misses = created[0] + created[1] + created[2];
+	counts.add(stats::Counter::MidpointMisses, misses);
+	counts.add(stats::Counter::MidpointHits, 3 - misses);
+	counts.add(stats::Counter::FacesCreated, 4);
+
+	/// Create new faces using the original vertices and the new midpoints,
+	/// the child slots (corner 0, corner 1, corner 2, center) define their ids
+	return {
+		this->addFace(faceid::childOf(face, 0), vertexIndices[0], mid1, mid3),
+		this->addFace(faceid::childOf(face, 1), mid1, vertexIndices[1], mid2),
+		this->addFace(faceid::childOf(face, 2), mid3, mid2, vertexIndices[2]),
+		this->addFace(faceid::childOf(face, 3), mid1, mid2, mid3)
+	};
 }
 
-void Icosphere::setNeighborsForBaseFaces() const {
-	for (auto& currentFace : this->baseFaces) {
-		std::array<unsigned int, 3> currentIndices = currentFace->getVertexIndices();
-		std::sort(currentIndices.begin(), currentIndices.end());
-
-		int neighborCount = 0;
-
-		for (auto& potentialNeighbor : this->baseFaces) {
-			if (currentFace == potentialNeighbor) continue; /// Skip the same face
-
-			std::array<unsigned int, 3> neighborIndices = potentialNeighbor->getVertexIndices();
-			std::sort(neighborIndices.begin(), neighborIndices.end());
-
-			std::array<unsigned int, 3> intersection{};
-			const auto it = std::set_intersection(currentIndices.begin(), currentIndices.end(),
-			                                      neighborIndices.begin(), neighborIndices.end(),
-			                                      intersection.begin());
-			const size_t matches = it - intersection.begin();
-
-			if (matches == 2) { /// If exactly two indices match, it's a neighbor
-				std::cout << "setNeighbor(" << potentialNeighbor->getVertexIndices()[0] << ", "
-					<< potentialNeighbor->getVertexIndices()[1] << ", "
-					<< potentialNeighbor->getVertexIndices()[2] << ")\n";
-				currentFace->setNeighbor(neighborCount++, potentialNeighbor);
-				if (neighborCount == 3) break; /// Each face has exactly 3 neighbors
-			}
+void Icosphere::subdivideFace(const FaceId face, const std::array<LatticePoint, 3>& corners,
+	unsigned int currentLevel, unsigned int firstLevel, unsigned int targetLevel, stats::LocalCounts& counts) {
+	if (currentLevel >= targetLevel) {
+		return; /// Base case: Reached the desired level of subdivision
+	}
+	const std::array<unsigned int, 3>& vertexIndices = this->faces[face].vertexIndices;
+	LOG_TRACE("subdivideFace(", vertexIndices[0], ", ", vertexIndices[1], ", ", vertexIndices[2], "): ",
+		currentLevel, " : ", targetLevel);
+
+	/// Faces above firstLevel were split by an earlier subdivide, descend into their children.
+	/// Depth-first order can reach an edge before the face that creates its endpoints,
+	/// so this serial path writes every midpoint itself.
+	std::array<FaceId, 4> children;
+	if (currentLevel < firstLevel) {
+		for (unsigned int slot = 0; slot < 4; ++slot) {
+			children[slot] = faceid::childOf(face, slot);
 		}
-		std::cout << "setNeighborsForBaseFaces found " << neighborCount << " neighbors\n";
+	} else {
+		children = this->splitFace(face, corners, true, counts);
+	}
+
+	/// Recursively subdivide the children
+	for (unsigned int slot = 0; slot < 4; ++slot) {
+		subdivideFace(children[slot], VertexNumbering::childCorners(corners, slot), currentLevel + 1, firstLevel,
+			targetLevel, counts);
 	}
 }
 
+void Icosphere::updateNeighbors(const unsigned int threadCount) {
+	this->setNeighbors(0, threadCount);
+}
 
-void Icosphere::setNeighborsForFace(const std::shared_ptr<Face>& face) {
-	auto parent = face->getParent();
-	if (!parent)
+void Icosphere::setNeighbors(const FaceId first, const unsigned int threadCount) {
+	/// Nothing is new when subdivide kept or dropped levels
+	if (first >= this->faces.size())
 		return;
-
-	std::cout << "setNeighborsForFace\n";
-
-	int neighborCount = 0;
-	std::array<unsigned int, 3> myIndices = face->getVertexIndices();
-	std::sort(myIndices.begin(), myIndices.end());
-
-	/// check my siblings first
-	for (const auto& sibling : parent->getChildren()) {
-		if (!sibling)
-			continue; /// Skip if sibling has no child at this index
-
-		std::array<unsigned int, 3> siblingIndices = sibling->getVertexIndices();
-		std::sort(siblingIndices.begin(), siblingIndices.end());
-
-		/// Count matching indices
-		std::array<unsigned int, 3> intersection{};
-		const auto it = std::set_intersection(myIndices.begin(), myIndices.end(),
-		                                      siblingIndices.begin(), siblingIndices.end(),
-		                                      intersection.begin());
-		const size_t matches = it - intersection.begin();
-		std::cout << "myIndices:      " << myIndices[0] << ", " << myIndices[1] << ", " << myIndices[2] << "\n";
-		std::cout << "siblingIndices: " << siblingIndices[0] << ", " << siblingIndices[1] << ", " << siblingIndices[2] << "\n";
-		std::cout << "setNeighborsForFace, intersections: " << matches << "\n";
-
-		/// If exactly two indices match, it's a neighbor
-		if (matches == 2) {
-			std::cout << "setNeighbor(" << sibling->getVertexIndices()[0] << ", "
-				<< sibling->getVertexIndices()[1] << ", "
-				<< sibling->getVertexIndices()[2] << ")\n";
-			neighborCount++;
-			face->addNeighbor(sibling);
-		}
-	}
-
-	/// Now check my cusins 
-	const auto grandparent = parent->getParent();
-	if (grandparent) {
-
-		std::array<std::shared_ptr<Face>, 4> siblings = grandparent->getChildren();
-
-		/// Check siblings of the parent (which are my siblings and cousins) to find neighbors
-		for (auto& sibling : siblings) {
-			if (sibling == parent || !sibling)
-				continue; /// Skip my parent (did that already) and any null siblings
-
-			for (int i = 0; i < 4; ++i) { /// Checking all 4 children
-				auto siblingChild = sibling->getChild(i);
-				if (!siblingChild)
-					continue; /// Skip if sibling has no child at this index
-
-				std::array<unsigned int, 3> siblingIndices = siblingChild->getVertexIndices();
-				std::sort(siblingIndices.begin(), siblingIndices.end());
-
-				/// Count matching indices
-				std::array<unsigned int, 3> intersection{};
-				const auto it = std::set_intersection(myIndices.begin(), myIndices.end(),
-												siblingIndices.begin(), siblingIndices.end(),
-												intersection.begin());
-				size_t matches = it - intersection.begin();
-				std::cout << "myIndices:      " << myIndices[0] << ", " << myIndices[1] << ", " << myIndices[2] << "\n";
-				std::cout << "siblingIndices: " << siblingIndices[0] << ", " << siblingIndices[1] << ", " << siblingIndices[2] << "\n";
-				std::cout << "setNeighborsForFace, intersections: " << matches << "\n";
-
-				/// If exactly two indices match, it's a neighbor
-				if (matches == 2) {
-					std::cout << "setNeighbor(" << siblingChild->getVertexIndices()[0] << ", "
-						<< siblingChild->getVertexIndices()[1] << ", "
-						<< siblingChild->getVertexIndices()[2] << ")\n";
-					neighborCount++;
-					face->addNeighbor(siblingChild);
-				}
+	const stats::ScopedTimer timer(this->statsRecorder, stats::Phase::SetNeighbors);
+	/// neighbors[k] is the face across the edge from vertex k to vertex k + 1,
+	/// computed from the lattice for every face from first on. Neighbors lie on
+	/// the same level, so the links of earlier levels stay valid.
+	parallelForRanges(first, this->faces.size(), threadCount, [this](const FaceId begin, const FaceId end) {
+		for (FaceId face = begin; face < end; ++face) {
+			const std::array<FaceId, 3> neighbors = this->lattice.neighborsOf(face);
+			for (unsigned int edge = 0; edge < 3; ++edge) {
+				this->faces.setNeighbor(face, edge, neighbors[edge]);
 			}
 		}
-	}
-	std::cout << "setNeighborsForFace found " << neighborCount << " neighbors\n";
+	});
+	LOG_DEBUG("setNeighbors: ", this->faces.size() - first, " faces");
 
-	/// Recursively set neighbors for children
-	for (int i = 0; i < 4; ++i) { /// Updated to iterate over all 4 children
-		if (face->getChild(i))
-			this->setNeighborsForFace(face->getChild(i));
-		else
-			std::cout << "no child\n";
-	}
+	/// Tree mode: mirror the neighbor links into the Face objects
+	if (this->storage == FaceStorage::Tree)
+		this->linkTreeNeighbors(first);
 }
 
-std::shared_ptr<Face> Icosphere::getFaceAtPointRecursive(const std::shared_ptr<Face> &face, const Vector3 &normalizedPoint) const {
-	if (!intersectsLine(face, Vector3(0,0,0), normalizedPoint)) {
-		return nullptr;
+void Icosphere::linkTreeNeighbors(const FaceId first) {
+	for (FaceId id = first; id < this->faces.size(); ++id) {
+		for (unsigned int index = 0; index < 3; ++index) {
+			const FaceId neighbor = this->faces.getNeighbor(id, index);
+			this->treeFaces[id]->setNeighbor(index,
+				neighbor == InvalidFaceId ? nullptr : this->treeFaces[neighbor]);
+		}
 	}
+}
 
-	/// If this is a leaf face, return it
-	if (face->getChildren().empty()) {
-		return face;
+void Icosphere::releaseTreeFaces(const FaceId first) {
+	/// Neighbor links form cycles, so the nodes are unlinked before they are dropped
+	for (FaceId id = first; id < this->treeFaces.size(); ++id) {
+		if (!this->treeFaces[id])
+			continue;
+		for (unsigned int index = 0; index < 3; ++index) {
+			this->treeFaces[id]->setNeighbor(index, nullptr);
+		}
 	}
-
-	/// Check children
-	for (const auto& child : face->getChildren()) {
-		auto result = getFaceAtPointRecursive(child, normalizedPoint);
-		if (result) return result;
+	/// first is the start of a level, the level above it loses its children
+	if (first > 0) {
+		for (FaceId id = faceid::parentOf(first); id < first; ++id) {
+			for (unsigned int slot = 0; slot < 4; ++slot) {
+				this->treeFaces[id]->setChild(slot, nullptr);
+			}
+		}
 	}
-
-	return nullptr;
-}
-
-bool Icosphere::intersectsLine(const std::shared_ptr<Face> &face, const Vector3 &lineStart,
-	const Vector3 &lineEnd) const {
-	/// Möller-Trumbore algorithm for intersecting line - triangle
-	/// Get the vertices of the face
-	std::array<unsigned int, 3> vertexIndices = face->getVertexIndices();
-	const Vector3& v0 = vertices[vertexIndices[0]];
-	const Vector3& v1 = vertices[vertexIndices[1]];
-	const Vector3& v2 = vertices[vertexIndices[2]];
-
-	Vector3 direction = lineEnd - lineStart;
-
-	/// Edge vectors
-	Vector3 e1 = v1 - v0;
-	Vector3 e2 = v2 - v0;
-
-	/// Calculate determinant
-	Vector3 pvec = direction.cross(e2);
-	float det = e1.dot(pvec);
-
-	/// If determinant is near zero, ray lies in plane of triangle
-	if (std::fabs(det) < EPSILON) return false;
-
-	float invDet = 1.0f / det;
-
-	/// Calculate u parameter and test bounds
-	Vector3 tvec = lineStart - v0;
-	float u = tvec.dot(pvec) * invDet;
-	if (u < 0.0f || u > 1.0f) return false;
-
-	/// Prepare to test v parameter
-	Vector3 qvec = tvec.cross(e1);
-
-	/// Calculate v parameter and test bounds
-	float v = direction.dot(qvec) * invDet;
-	if (v < 0.0f || u + v > 1.0f) return false;
-
-	/// Calculate t, ray intersects triangle
-	float t = e2.dot(qvec) * invDet;
-
-	/// Check if the intersection point is between lineStart and lineEnd
-	return (t >= 0.0f && t <= 1.0f);
+	this->treeFaces.resize(first);
 }
-} /// namespace lillugsi::planet
\ No newline at end of file
+} /// namespace lillugsi::planet
@@ -1,28 +1,137 @@
 #pragma once
 
 #include "vector3.h"
+#include "vertexbuffer.h"
 #include "face.h"
+#include "facearena.h"
+#include "facestore.h"
+#include "facechannel.h"
+#include "vertexnumbering.h"
+#include "facelattice.h"
+#include "pointlocator.h"
+#include "facequery.h"
+#include "icospherestats.h"
+#include "parallel.h"
+#include <span>
 #include <vector>
-#include <map>
 
 namespace lillugsi::planet {
+class SphereFile;
+
+/// How an Icosphere keeps its faces in memory.
+/// The flat FaceStore is always filled, Tree additionally builds the
+/// shared_ptr Face hierarchy on top of it for the pointer based API.
+/// The Face nodes live in a FaceArena shared by the Icosphere and the nodes. Its blocks
+/// are freed in one go once the Icosphere and every shared_ptr to a node are gone,
+/// load starts a new arena.
+/// Nodes held past the Icosphere keep their data but lose their neighbor and child links.
+enum class FaceStorage {
+	Tree,
+	Flat
+};
+
 class Icosphere {
 public:
-	Icosphere();
+	explicit Icosphere(FaceStorage storage = FaceStorage::Tree);
 	~Icosphere();
 
-	/// Methods for icosphere generation and manipulation
-	void subdivide(int levels);
+	/// Methods for icosphere generation and manipulation.
+	/// Each level is split across threadCount threads (0: one per hardware thread),
+	/// the result does not depend on the thread count. A second call keeps the existing
+	/// levels and only splits the leaves, or drops levels when levels is smaller.
+	/// In tree mode dropped Face nodes are unlinked, but the arena only returns their
+	/// memory once every node is released (destruction or load), so splitting the
+	/// dropped levels again allocates new nodes.
+	void subdivide(int levels, unsigned int threadCount = 1);
+	/// Depth-first reference implementation of subdivide, produces the same vertices, indices and faces
+	void subdivideRecursive(int levels);
+	/// Replaces all levels with those of a sphere file, face data included, without
+	/// subdividing: the buffers are copied and tree mode links its Face nodes. Returns false
+	/// and logs an error, leaving the sphere unchanged, if the base faces do not match.
+	bool load(const SphereFile& file);
+	/// Recomputes the neighbor links of every face, tree mode included. The constructor links
+	/// the base faces and subdivide the faces it creates, so this only restores links
+	/// changed through getFaces().
+	void updateNeighbors(unsigned int threadCount = 1);
 
-	/// Accessors
+	/// Accessors, getVertices and getIndices return copies of all levels
 	[[nodiscard]] std::vector<Vector3> getVertices() const;
+	[[nodiscard]] const VertexBuffer& getVertexBuffer() const { return this->vertices; }
 	[[nodiscard]] std::vector<unsigned int> getIndices() const;
 
+	/// Zero-copy views for rendering and export. Vertices are numbered level by level
+	/// and the index buffer is laid out by FaceId, so the mesh of one level is a prefix
+	/// of the vertices plus one contiguous index range. Views stay valid until the
+	/// next subdivide. Levels that were not subdivided give empty views.
+	[[nodiscard]] unsigned int getLevelCount() const { return this->faces.getLevelCount(); }
+	[[nodiscard]] VertexView getLevelVertices(unsigned int level) const;
+	[[nodiscard]] std::span<const unsigned int> getLevelIndices(unsigned int level) const;
+	/// The deepest level, whose faces are the leaves
+	[[nodiscard]] VertexView getLeafVertices() const;
+	[[nodiscard]] std::span<const unsigned int> getLeafIndices() const;
+	/// Triangles of all levels, 3 * FaceId is the first index of a face
+	[[nodiscard]] std::span<const unsigned int> getIndexBuffer() const { return this->indices; }
+	[[nodiscard]] FaceStorage getFaceStorage() const { return this->storage; }
+	[[nodiscard]] const FaceStore& getFaces() const { return this->faces; }
+	[[nodiscard]] FaceStore& getFaces() { return this->faces; }
+	[[nodiscard]] const FaceLattice& getLattice() const { return this->lattice; }
+	[[nodiscard]] const VertexNumbering& getVertexNumbering() const { return this->vertexNumbering; }
+	/// Data of a face, kept in the Face node in tree mode and in the FaceStore otherwise
+	[[nodiscard]] float getFaceData(const FaceId id) const {
+		return this->storage == FaceStorage::Tree ? this->treeFaces[id]->getData() : this->faces.getData(id);
+	}
+	void setFaceData(const FaceId id, const float value) {
+		if (this->storage == FaceStorage::Tree)
+			this->treeFaces[id]->setData(value);
+		else
+			this->faces.setData(id, value);
+	}
+
 	/// Visitor
 	static void applyVisitorToFace(const std::shared_ptr<Face> &face, FaceVisitor& visitor);
-	void applyVisitor(FaceVisitor& visitor) const;
+	static void applyVisitorToFace(FaceStore& faces, FaceId id, FaceVisitor& visitor);
+	void applyVisitor(FaceVisitor& visitor);
+	/// Calls visitor.visit(channel, id) for every face in FaceId order
+	void applyVisitor(FaceVisitor& visitor, FaceChannel<float>& channel);
+
+	/// Named, typed per-face data channels, sized to the level count on every subdivide.
+	/// Unlike the single data float of a face each field is its own array.
+	[[nodiscard]] FaceChannels& getChannels() { return this->channels; }
+	[[nodiscard]] const FaceChannels& getChannels() const { return this->channels; }
+
+	/// Calls function(id) for every face of a level in FaceId order. Unlike the
+	/// visitors this is a plain loop over the contiguous level range: no recursion,
+	/// no virtual call and no shared_ptr copy per face, so the function inlines.
+	/// Use get/setFaceData for the data, they work in both storage modes, and
+	/// getFaces()[id] for vertex indices and neighbors.
+	template <typename Function>
+	void forEachFace(unsigned int level, Function&& function) const;
+	/// Same, with the level range split into one contiguous chunk per thread
+	/// (0: one per hardware thread). With 1, 2, 4, 5, 10 or 20 threads every chunk is a set of
+	/// whole base face subtrees. function must be safe to call concurrently for different faces.
+	template <typename Function>
+	void parallelForEachFace(unsigned int level, unsigned int threadCount, Function&& function) const;
 
+	/// Returns nullptr in flat storage mode, use getFaceIdAtPoint instead
 	std::shared_ptr<Face> getFaceAtPoint(const Vector3& point) const;
+	/// Leaf face containing the point
+	[[nodiscard]] FaceId getFaceIdAtPoint(const Vector3& point) const;
+	/// Face containing the point on the given level, O(level)
+	[[nodiscard]] FaceId locate(const Vector3& point, unsigned int level) const;
+	/// Batched locate of many points on one level, see PointLocator::locatePoints
+	void locatePoints(std::span<const Vector3> points, std::span<FaceId> faceIds, unsigned int level,
+		unsigned int threadCount = 1) const;
+	/// Faces of a level intersecting a region, see FaceQuery::findFaces.
+	/// Writes the first min(count, faceIds.size()) ids and returns the count.
+	[[nodiscard]] std::size_t findFaces(const SphericalRegion& region, unsigned int level,
+		std::span<FaceId> faceIds) const;
+	/// Face of a level with the centroid closest to the point, see FaceQuery::findNearestFace
+	[[nodiscard]] FaceId findNearestFace(const Vector3& point, unsigned int level) const;
+
+	/// Counters and phase timers since construction or the last resetStats.
+	/// Only recorded when built with the ICOSPHERE_STATS CMake option, otherwise all zero.
+	[[nodiscard]] IcosphereStats getStats() const { return this->statsRecorder.snapshot(); }
+	void resetStats() { this->statsRecorder.reset(); }
 
 private:
 	/// Copy constructor
@@ -34,27 +143,63 @@ private:
 
 	/// Helper methods
 	unsigned int addVertex(Vector3 vertex);
-	std::shared_ptr<Face> addFace(unsigned int v1, unsigned int v2, unsigned int v3);
-
-	unsigned int getOrCreateMidpointIndex(unsigned int index1, unsigned int index2); /// Helper to handle midpoint vertices
-	void subdivideFace(const std::shared_ptr<Face> &face, unsigned int currentLevel, unsigned int targetLevel);
-
-	void setNeighbors();
-	void setNeighborsForBaseFaces() const;
-	void setNeighborsForFace(const std::shared_ptr<Face>& face);
+	FaceId addFace(FaceId id, unsigned int v1, unsigned int v2, unsigned int v3);
 
-	std::shared_ptr<Face> getFaceAtPointRecursive(const std::shared_ptr<Face>& face,
-											  const Vector3& normalizedPoint) const;
+	unsigned int getMidpointIndex(FaceId baseFace, unsigned int level, LatticePoint midpoint,
+		unsigned int index1, unsigned int index2, bool create); /// Helper to handle midpoint vertices
+	unsigned int prepareSubdivision(int levels);
+	void computeMidpoints(unsigned int level, unsigned int threadCount);
+	void subdivideLevel(unsigned int level, FaceId begin, FaceId end);
+	std::array<FaceId, 4> splitFace(FaceId face, const std::array<LatticePoint, 3>& corners, bool createAllMidpoints,
+		stats::LocalCounts& counts);
+	void subdivideFace(FaceId face, const std::array<LatticePoint, 3>& corners,
+		unsigned int currentLevel, unsigned int firstLevel, unsigned int targetLevel, stats::LocalCounts& counts);
 
-	bool intersectsLine(const std::shared_ptr<Face>& face,
-							const Vector3& lineStart, const Vector3& lineEnd) const;
+	void setNeighbors(FaceId first, unsigned int threadCount);
+	/// Tree mode: copies the neighbor links of the FaceStore into the Face nodes from first on
+	void linkTreeNeighbors(FaceId first);
+	/// Tree mode: drops the Face nodes from first, the start of a level, on
+	void releaseTreeFaces(FaceId first);
 
 	/// Data
-	std::vector<Vector3> vertices;
+	FaceStorage storage;
+	VertexBuffer vertices;
 	std::vector<unsigned int> indices;
-	std::map<std::pair<unsigned int, unsigned int>, unsigned int> midpointIndexCache; /// Cache to store midpoints
-	std::vector<std::shared_ptr<Face>> baseFaces;
-
-	static constexpr float EPSILON = 0.0000001f;
+	/// During subdivision only: the two parents of each vertex above the base 12,
+	/// the positions are computed from them level by level in batches
+	std::vector<unsigned int> firstParents;
+	std::vector<unsigned int> secondParents;
+	VertexNumbering vertexNumbering; /// Analytic midpoint indices, replaces an edge-to-midpoint cache
+	FaceLattice lattice; /// Analytic face adjacency
+	PointLocator locator; /// Point to face location
+	FaceStore faces;
+	FaceChannels channels;
+	/// Tree mode only: the Face node of each FaceId, allocated from faceArena
+	std::shared_ptr<FaceArena> faceArena;
+	std::vector<std::shared_ptr<Face>> treeFaces;
+	mutable stats::Recorder statsRecorder; /// Also updated by the const point lookups
 };
-} /// namespace lillugsi::planet
\ No newline at end of file
+
+template <typename Function>
+void Icosphere::forEachFace(const unsigned int level, Function&& function) const {
+	if (level >= this->faces.getLevelCount())
+		return;
+	const FaceId end = this->faces.getLevelEnd(level);
+	for (FaceId id = this->faces.getLevelBegin(level); id < end; ++id) {
+		function(id);
+	}
+}
+
+template <typename Function>
+void Icosphere::parallelForEachFace(const unsigned int level, const unsigned int threadCount,
+	Function&& function) const {
+	if (level >= this->faces.getLevelCount())
+		return;
+	parallelForRanges(this->faces.getLevelBegin(level), this->faces.getLevelEnd(level), threadCount,
+		[&function](const FaceId begin, const FaceId end) {
+			for (FaceId id = begin; id < end; ++id) {
+				function(id);
+			}
+		});
+}
+} /// namespace lillugsi::planet
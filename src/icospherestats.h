@@ -0,0 +1,176 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/// Compile-time switch for the counters and phase timers, set by the ICOSPHERE_STATS
+/// CMake option. When 0 the recorders below are empty and every call compiles to nothing.
+#ifndef LILLUGSI_STATS
+#define LILLUGSI_STATS 0
+#endif
+
+namespace lillugsi::planet {
+/// Counters and phase timers of an Icosphere, see Icosphere::getStats.
+/// Counts are totals since construction or the last resetStats, times are wall clock
+/// nanoseconds summed over all calls of a phase. All zero in builds without stats.
+struct IcosphereStats {
+	std::uint64_t facesCreated{0};
+	std::uint64_t verticesCreated{0};
+	/// Midpoint lookups during subdivision. Vertex indices are analytic, so a lookup
+	/// never searches; a miss is a lookup that records the parents of a new vertex,
+	/// a hit one whose vertex is recorded by the face across the edge.
+	/// Both are a fixed function of the topology: subdivide misses once per new vertex
+	/// and hits on the other lookups (3 per split face), subdivideRecursive always
+	/// misses. They check the numbering, they do not measure a cache.
+	std::uint64_t midpointHits{0};
+	std::uint64_t midpointMisses{0};
+	/// Point lookups (getFaceAtPoint, getFaceIdAtPoint, locate, locatePoints) and the
+	/// triangle tests PointLocator made for them, one per level descended below the
+	/// base face. Lookups of the zero vector stop before the descent and test nothing.
+	std::uint64_t pointLookups{0};
+	std::uint64_t triangleTests{0};
+
+	std::uint64_t subdivideNanoseconds{0};        /// subdivide and subdivideRecursive as a whole
+	std::uint64_t splitFacesNanoseconds{0};       /// Splitting faces, addFace included
+	std::uint64_t computeMidpointsNanoseconds{0}; /// Midpoint positions
+	std::uint64_t setNeighborsNanoseconds{0};     /// Neighbor links, tree mode mirroring included
+	std::uint64_t locateNanoseconds{0};           /// Point lookups
+
+	[[nodiscard]] double getTriangleTestsPerLookup() const {
+		return this->pointLookups == 0 ? 0.0
+			: static_cast<double>(this->triangleTests) / static_cast<double>(this->pointLookups);
+	}
+};
+
+namespace stats {
+constexpr bool Enabled = LILLUGSI_STATS != 0;
+
+enum class Counter : unsigned int {
+	FacesCreated,
+	VerticesCreated,
+	MidpointHits,
+	MidpointMisses,
+	PointLookups,
+	TriangleTests,
+	Count
+};
+
+enum class Phase : unsigned int {
+	Subdivide,
+	SplitFaces,
+	ComputeMidpoints,
+	SetNeighbors,
+	Locate,
+	Count
+};
+
+/// Shared totals, safe to update from several threads
+class Recorder {
+public:
+	void add([[maybe_unused]] const Counter counter, [[maybe_unused]] const std::uint64_t value) {
+#if LILLUGSI_STATS
+		this->counters[static_cast<unsigned int>(counter)].fetch_add(value, std::memory_order_relaxed);
+#endif
+	}
+	void addTime([[maybe_unused]] const Phase phase, [[maybe_unused]] const std::uint64_t nanoseconds) {
+#if LILLUGSI_STATS
+		this->nanoseconds[static_cast<unsigned int>(phase)].fetch_add(nanoseconds, std::memory_order_relaxed);
+#endif
+	}
+
+	void reset() {
+#if LILLUGSI_STATS
+		for (auto& counter : this->counters) {
+			counter.store(0, std::memory_order_relaxed);
+		}
+		for (auto& time : this->nanoseconds) {
+			time.store(0, std::memory_order_relaxed);
+		}
+#endif
+	}
+
+	[[nodiscard]] IcosphereStats snapshot() const {
+		IcosphereStats result;
+#if LILLUGSI_STATS
+		const auto counter = [this](const Counter index) {
+			return this->counters[static_cast<unsigned int>(index)].load(std::memory_order_relaxed);
+		};
+		const auto time = [this](const Phase index) {
+			return this->nanoseconds[static_cast<unsigned int>(index)].load(std::memory_order_relaxed);
+		};
+		result.facesCreated = counter(Counter::FacesCreated);
+		result.verticesCreated = counter(Counter::VerticesCreated);
+		result.midpointHits = counter(Counter::MidpointHits);
+		result.midpointMisses = counter(Counter::MidpointMisses);
+		result.pointLookups = counter(Counter::PointLookups);
+		result.triangleTests = counter(Counter::TriangleTests);
+		result.subdivideNanoseconds = time(Phase::Subdivide);
+		result.splitFacesNanoseconds = time(Phase::SplitFaces);
+		result.computeMidpointsNanoseconds = time(Phase::ComputeMidpoints);
+		result.setNeighborsNanoseconds = time(Phase::SetNeighbors);
+		result.locateNanoseconds = time(Phase::Locate);
+#endif
+		return result;
+	}
+
+private:
+#if LILLUGSI_STATS
+	std::array<std::atomic<std::uint64_t>, static_cast<unsigned int>(Counter::Count)> counters{};
+	std::array<std::atomic<std::uint64_t>, static_cast<unsigned int>(Phase::Count)> nanoseconds{};
+#endif
+};
+
+/// Counts of one thread, added to the Recorder in one go instead of per event
+class LocalCounts {
+public:
+	void add([[maybe_unused]] const Counter counter, [[maybe_unused]] const std::uint64_t value) {
+#if LILLUGSI_STATS
+		this->counters[static_cast<unsigned int>(counter)] += value;
+#endif
+	}
+	void flushTo([[maybe_unused]] Recorder& recorder) {
+#if LILLUGSI_STATS
+		for (unsigned int counter = 0; counter < this->counters.size(); ++counter) {
+			if (this->counters[counter] != 0)
+				recorder.add(static_cast<Counter>(counter), this->counters[counter]);
+			this->counters[counter] = 0;
+		}
+#endif
+	}
+
+private:
+#if LILLUGSI_STATS
+	std::array<std::uint64_t, static_cast<unsigned int>(Counter::Count)> counters{};
+#endif
+};
+
+/// Adds the lifetime of the scope to a phase
+class ScopedTimer {
+public:
+	ScopedTimer([[maybe_unused]] Recorder& recorder, [[maybe_unused]] const Phase phase)
+#if LILLUGSI_STATS
+	: recorder(recorder), phase(phase), start(std::chrono::steady_clock::now())
+#endif
+	{}
+	~ScopedTimer() {
+#if LILLUGSI_STATS
+		const auto elapsed = std::chrono::steady_clock::now() - this->start;
+		this->recorder.addTime(this->phase,
+			static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+#endif
+	}
+
+	ScopedTimer(const ScopedTimer& other) = delete;
+	ScopedTimer& operator=(const ScopedTimer& other) = delete;
+
+private:
+#if LILLUGSI_STATS
+	Recorder& recorder;
+	Phase phase;
+	std::chrono::steady_clock::time_point start;
+#endif
+};
+} /// namespace stats
+} /// namespace lillugsi::planet
@@ -0,0 +1,42 @@
+#include "log.h"
+
+#include <atomic>
+#include <iostream>
+#include <mutex>
+
+namespace lillugsi::planet::log {
+namespace {
+std::atomic<Level> runtimeLevel{CompiledLevel};
+std::mutex outputMutex;
+
+const char* levelName(const Level level) {
+	switch (level) {
+	case Level::Trace: return "trace";
+	case Level::Debug: return "debug";
+	case Level::Info: return "info";
+	case Level::Warn: return "warn";
+	case Level::Error: return "error";
+	default: return "";
+	}
+}
+} /// namespace
+
+void setLevel(const Level level) {
+	runtimeLevel.store(level, std::memory_order_relaxed);
+}
+
+Level getLevel() {
+	return runtimeLevel.load(std::memory_order_relaxed);
+}
+
+bool isEnabled(const Level level) {
+	return isCompiled(level) && level >= getLevel();
+}
+
+void writeLine(const Level level, const std::string& message) {
+	/// Warnings and errors go to stderr, no flush per line for the rest
+	std::ostream& stream = level >= Level::Warn ? std::cerr : std::cout;
+	const std::lock_guard<std::mutex> lock(outputMutex);
+	stream << "[" << levelName(level) << "] " << message << '\n';
+}
+} /// namespace lillugsi::planet::log
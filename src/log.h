@@ -0,0 +1,67 @@
+#pragma once
+
+#include <sstream>
+#include <string>
+
+/// Log levels as plain numbers, so they can be passed on the compiler command line
+#define LILLUGSI_LOG_LEVEL_TRACE 0
+#define LILLUGSI_LOG_LEVEL_DEBUG 1
+#define LILLUGSI_LOG_LEVEL_INFO 2
+#define LILLUGSI_LOG_LEVEL_WARN 3
+#define LILLUGSI_LOG_LEVEL_ERROR 4
+#define LILLUGSI_LOG_LEVEL_OFF 5
+
+/// Compile-time minimum level, messages below it are compiled out entirely
+#ifndef LILLUGSI_LOG_LEVEL
+#define LILLUGSI_LOG_LEVEL LILLUGSI_LOG_LEVEL_INFO
+#endif
+
+namespace lillugsi::planet::log {
+enum class Level {
+	Trace = LILLUGSI_LOG_LEVEL_TRACE,
+	Debug = LILLUGSI_LOG_LEVEL_DEBUG,
+	Info = LILLUGSI_LOG_LEVEL_INFO,
+	Warn = LILLUGSI_LOG_LEVEL_WARN,
+	Error = LILLUGSI_LOG_LEVEL_ERROR,
+	Off = LILLUGSI_LOG_LEVEL_OFF
+};
+
+constexpr Level CompiledLevel = static_cast<Level>(LILLUGSI_LOG_LEVEL);
+
+constexpr bool isCompiled(const Level level) {
+	return level >= CompiledLevel && level != Level::Off;
+}
+
+/// Runtime threshold on top of the compiled one, defaults to the compiled level
+void setLevel(Level level);
+[[nodiscard]] Level getLevel();
+[[nodiscard]] bool isEnabled(Level level);
+
+/// Writes one complete line, lines from different threads do not interleave
+void writeLine(Level level, const std::string& message);
+
+/// Streams all arguments into one line
+template <typename... Args>
+void write(const Level level, const Args&... args) {
+	if (!isEnabled(level))
+		return;
+	std::ostringstream stream;
+	(stream << ... << args);
+	writeLine(level, stream.str());
+}
+} /// namespace lillugsi::planet::log
+
+/// Logging macros, the arguments are streamed with operator<<.
+/// Below LILLUGSI_LOG_LEVEL the call and its arguments are discarded at compile time.
+#define LILLUGSI_LOG(level, ...) \
+	do { \
+		if constexpr (::lillugsi::planet::log::isCompiled(level)) { \
+			::lillugsi::planet::log::write(level, __VA_ARGS__); \
+		} \
+	} while (false)
+
+#define LOG_TRACE(...) LILLUGSI_LOG(::lillugsi::planet::log::Level::Trace, __VA_ARGS__)
+#define LOG_DEBUG(...) LILLUGSI_LOG(::lillugsi::planet::log::Level::Debug, __VA_ARGS__)
+#define LOG_INFO(...) LILLUGSI_LOG(::lillugsi::planet::log::Level::Info, __VA_ARGS__)
+#define LOG_WARN(...) LILLUGSI_LOG(::lillugsi::planet::log::Level::Warn, __VA_ARGS__)
+#define LOG_ERROR(...) LILLUGSI_LOG(::lillugsi::planet::log::Level::Error, __VA_ARGS__)
@@ -1,6 +1,7 @@
 
 #include "icosphere.h"
 #include "datasettingvisitor.h"
+#include "log.h"
 
 int main() {
 	lillugsi::planet::Icosphere icosphere;
@@ -9,5 +10,17 @@ int main() {
 	lillugsi::planet::DataSettingVisitor dataVisitor;
 	icosphere.applyVisitor(dataVisitor);
 
+	LOG_INFO("Icosphere: ", icosphere.getLeafVertices().size(), " vertices, ",
+		icosphere.getLeafIndices().size() / 3, " leaf faces, ",
+		icosphere.getFaces().size(), " faces on all levels");
+
+	if constexpr (lillugsi::planet::stats::Enabled) {
+		const lillugsi::planet::IcosphereStats stats = icosphere.getStats();
+		LOG_INFO("Stats: ", stats.facesCreated, " faces, ", stats.verticesCreated, " vertices, midpoints ",
+			stats.midpointHits, " hits / ", stats.midpointMisses, " misses; subdivide ", stats.subdivideNanoseconds,
+			" ns (split ", stats.splitFacesNanoseconds, ", midpoints ", stats.computeMidpointsNanoseconds,
+			", neighbors ", stats.setNeighborsNanoseconds, ")");
+	}
+
 	return 0;
 }
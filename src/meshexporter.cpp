@@ -0,0 +1,294 @@
+#include "meshexporter.h"
+#include "icosphere.h"
+#include "filewriter.h"
+#include "log.h"
+
+#include <algorithm> /// For std::min and std::reverse
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+namespace lillugsi::planet {
+namespace {
+/// Faces per batch of STL normals and bytes buffered before a write
+constexpr std::size_t ChunkSize = 4096;
+constexpr std::size_t FlushSize = 1 << 16;
+
+/// Output bytes of the current chunk
+class ChunkBuffer {
+public:
+	explicit ChunkBuffer(FileWriter& writer) : writer(writer) {
+		this->bytes.reserve(FlushSize + 256);
+	}
+
+	void append(const char* data, const std::size_t count) {
+		this->bytes.insert(this->bytes.end(), data, data + count);
+	}
+	void append(const std::string_view text) {
+		this->append(text.data(), text.size());
+	}
+	void append(const char character) {
+		this->bytes.push_back(character);
+	}
+
+	/// Shortest text that reads back as the same value
+	template <typename T>
+	void appendText(const T value) {
+		std::array<char, 32> text{};
+		const auto result = std::to_chars(text.data(), text.data() + text.size(), value);
+		this->append(text.data(), static_cast<std::size_t>(result.ptr - text.data()));
+	}
+
+	template <typename T>
+	void appendLittleEndian(const T value) {
+		std::array<char, sizeof(T)> raw{};
+		std::memcpy(raw.data(), &value, sizeof(T));
+		if constexpr (std::endian::native == std::endian::big)
+			std::reverse(raw.begin(), raw.end());
+		this->append(raw.data(), raw.size());
+	}
+
+	void flushIfFull() {
+		if (this->bytes.size() >= FlushSize)
+			this->flush();
+	}
+	void flush() {
+		this->writer.write(this->bytes.data(), this->bytes.size());
+		this->bytes.clear();
+	}
+
+private:
+	FileWriter& writer;
+	std::vector<char> bytes;
+};
+
+/// The vertices and triangles of one level and a range of base faces, numbered for output
+class MeshSource {
+public:
+	MeshSource(const Icosphere& icosphere, const unsigned int level, const FaceId firstBaseFace, const FaceId endBaseFace)
+	: icosphere(icosphere), vertices(icosphere.getLevelVertices(level)), level(level),
+		firstBaseFace(firstBaseFace), endBaseFace(endBaseFace),
+		shared(firstBaseFace == 0 && endBaseFace == 20),
+		side(std::uint64_t{1} << level),
+		pointsPerBaseFace((side + 1) * (side + 2) / 2) {}
+
+	[[nodiscard]] std::uint64_t vertexCount() const {
+		if (this->shared)
+			return this->vertices.size();
+		return (this->endBaseFace - this->firstBaseFace) * this->pointsPerBaseFace;
+	}
+
+	[[nodiscard]] FaceId faceBegin() const {
+		return faceid::makeFaceId(this->firstBaseFace, this->level, 0);
+	}
+	[[nodiscard]] FaceId faceEnd() const {
+		return this->faceBegin() + static_cast<FaceId>((this->endBaseFace - this->firstBaseFace)
+			* (std::uint64_t{1} << (2 * this->level)));
+	}
+
+	/// function(position) for every output vertex in order
+	template <typename Function>
+	void forEachVertex(Function&& function) const {
+		if (this->shared) {
+			for (std::size_t index = 0; index < this->vertices.size(); ++index) {
+				function(this->vertices[index]);
+			}
+			return;
+		}
+		/// Row by row in the order of latticeIndex
+		const VertexNumbering& numbering = this->icosphere.getVertexNumbering();
+		const auto side32 = static_cast<std::uint32_t>(this->side);
+		for (FaceId baseFace = this->firstBaseFace; baseFace < this->endBaseFace; ++baseFace) {
+			for (std::uint32_t a = 0; a <= side32; ++a) {
+				for (std::uint32_t b = 0; b <= side32 - a; ++b) {
+					function(this->vertices[numbering.vertexIndex(baseFace, this->level, {a, b, side32 - a - b})]);
+				}
+			}
+		}
+	}
+
+	/// Output vertex numbers of a face, counterclockwise seen from outside
+	[[nodiscard]] std::array<unsigned int, 3> triangle(const FaceId id) const {
+		std::array<unsigned int, 3> result{};
+		if (this->shared) {
+			result = this->icosphere.getFaces()[id].vertexIndices;
+		} else {
+			const std::uint64_t first = (faceid::baseFaceOf(id) - this->firstBaseFace) * this->pointsPerBaseFace;
+			const std::array<LatticePoint, 3> corners = VertexNumbering::cornersOf(id);
+			for (unsigned int corner = 0; corner < 3; ++corner) {
+				result[corner] = static_cast<unsigned int>(first + this->latticeIndex(corners[corner]));
+			}
+		}
+		/// Every split reverses the stored order, so faces of even levels are stored clockwise
+		if (this->level % 2 == 0)
+			std::swap(result[1], result[2]);
+		return result;
+	}
+
+	/// triangle() corners as positions, same winding
+	[[nodiscard]] std::array<Vector3, 3> positions(const FaceId id) const {
+		const auto& stored = this->icosphere.getFaces()[id].vertexIndices;
+		std::array<Vector3, 3> result = {this->vertices[stored[0]], this->vertices[stored[1]], this->vertices[stored[2]]};
+		if (this->level % 2 == 0)
+			std::swap(result[1], result[2]);
+		return result;
+	}
+
+private:
+	/// Index of a lattice point in the per base face order of forEachVertex
+	[[nodiscard]] std::uint64_t latticeIndex(const LatticePoint& point) const {
+		const std::uint64_t row = point.a;
+		return row * (this->side + 1) - row * (row - 1) / 2 + point.b;
+	}
+
+	const Icosphere& icosphere;
+	VertexView vertices;
+	unsigned int level;
+	FaceId firstBaseFace;
+	FaceId endBaseFace;
+	bool shared;
+	std::uint64_t side;
+	std::uint64_t pointsPerBaseFace;
+};
+
+void writeObj(const MeshSource& source, ChunkBuffer& buffer, const unsigned int level) {
+	buffer.append("# Icosphere level ");
+	buffer.appendText(level);
+	buffer.append('\n');
+
+	source.forEachVertex([&buffer](const Vector3& vertex) {
+		buffer.append("v ");
+		buffer.appendText(vertex.x);
+		buffer.append(' ');
+		buffer.appendText(vertex.y);
+		buffer.append(' ');
+		buffer.appendText(vertex.z);
+		buffer.append('\n');
+		buffer.flushIfFull();
+	});
+	for (FaceId id = source.faceBegin(); id < source.faceEnd(); ++id) {
+		const std::array<unsigned int, 3> triangle = source.triangle(id);
+		buffer.append('f');
+		for (const unsigned int vertex : triangle) {
+			buffer.append(' ');
+			buffer.appendText(std::uint64_t{vertex} + 1);
+		}
+		buffer.append('\n');
+		buffer.flushIfFull();
+	}
+}
+
+void writePly(const Icosphere& icosphere, const MeshSource& source, ChunkBuffer& buffer,
+	const unsigned int level, const bool faceData) {
+	buffer.append("ply\nformat binary_little_endian 1.0\ncomment Icosphere level " + std::to_string(level)
+		+ "\nelement vertex " + std::to_string(source.vertexCount())
+		+ "\nproperty float x\nproperty float y\nproperty float z\nelement face "
+		+ std::to_string(source.faceEnd() - source.faceBegin())
+		+ "\nproperty list uchar uint vertex_indices\n"
+		+ (faceData ? "property float data\n" : "") + "end_header\n");
+
+	source.forEachVertex([&buffer](const Vector3& vertex) {
+		buffer.appendLittleEndian(vertex.x);
+		buffer.appendLittleEndian(vertex.y);
+		buffer.appendLittleEndian(vertex.z);
+		buffer.flushIfFull();
+	});
+	for (FaceId id = source.faceBegin(); id < source.faceEnd(); ++id) {
+		buffer.appendLittleEndian(std::uint8_t{3});
+		for (const unsigned int vertex : source.triangle(id)) {
+			buffer.appendLittleEndian(static_cast<std::uint32_t>(vertex));
+		}
+		if (faceData)
+			buffer.appendLittleEndian(icosphere.getFaceData(id));
+		buffer.flushIfFull();
+	}
+}
+
+void writeStl(const MeshSource& source, ChunkBuffer& buffer, const unsigned int level) {
+	std::array<char, 80> header{};
+	const std::string title = "Icosphere level " + std::to_string(level);
+	std::copy(title.begin(), title.end(), header.begin());
+	buffer.append(header.data(), header.size());
+	buffer.appendLittleEndian(static_cast<std::uint32_t>(source.faceEnd() - source.faceBegin()));
+
+	/// Face normals per chunk with the batch kernels: cross of the two edges from corner 0
+	std::vector<std::array<Vector3, 3>> triangles(ChunkSize);
+	VertexBuffer firstEdges;
+	VertexBuffer secondEdges;
+	VertexBuffer normals;
+	firstEdges.resize(ChunkSize);
+	secondEdges.resize(ChunkSize);
+	normals.resize(ChunkSize);
+
+	for (FaceId begin = source.faceBegin(); begin < source.faceEnd(); begin += ChunkSize) {
+		const auto count = static_cast<std::size_t>(std::min<FaceId>(ChunkSize, source.faceEnd() - begin));
+		for (std::size_t index = 0; index < count; ++index) {
+			triangles[index] = source.positions(begin + static_cast<FaceId>(index));
+			firstEdges.set(index, triangles[index][1] - triangles[index][0]);
+			secondEdges.set(index, triangles[index][2] - triangles[index][0]);
+		}
+		VertexBuffer::cross(firstEdges, secondEdges, 0, count, normals);
+		normals.normalize(0, count);
+
+		for (std::size_t index = 0; index < count; ++index) {
+			const Vector3 normal = normals[index];
+			buffer.appendLittleEndian(normal.x);
+			buffer.appendLittleEndian(normal.y);
+			buffer.appendLittleEndian(normal.z);
+			for (const Vector3& corner : triangles[index]) {
+				buffer.appendLittleEndian(corner.x);
+				buffer.appendLittleEndian(corner.y);
+				buffer.appendLittleEndian(corner.z);
+			}
+			buffer.appendLittleEndian(std::uint16_t{0});
+			buffer.flushIfFull();
+		}
+	}
+}
+} /// namespace
+
+bool MeshExporter::write(const Icosphere& icosphere, const std::string& path, const ExportOptions& options) {
+	if (icosphere.getLevelCount() == 0) {
+		LOG_ERROR("MeshExporter::write: the icosphere has no faces");
+		return false;
+	}
+	const unsigned int level = std::min(options.level, icosphere.getLevelCount() - 1);
+	const FaceId endBaseFace = std::min<FaceId>(options.endBaseFace, 20);
+	if (options.firstBaseFace >= endBaseFace) {
+		LOG_ERROR("MeshExporter::write: empty base face range ", options.firstBaseFace, " - ", options.endBaseFace);
+		return false;
+	}
+	if (options.faceData && options.format != MeshFormat::Ply)
+		LOG_WARN("MeshExporter::write: face data is only written to PLY files");
+
+	FileWriter writer(path);
+	if (!writer.isOpen()) {
+		LOG_ERROR("MeshExporter::write: cannot open ", path);
+		return false;
+	}
+	const MeshSource source(icosphere, level, options.firstBaseFace, endBaseFace);
+	ChunkBuffer buffer(writer);
+	switch (options.format) {
+	case MeshFormat::Obj:
+		writeObj(source, buffer, level);
+		break;
+	case MeshFormat::Ply:
+		writePly(icosphere, source, buffer, level, options.faceData);
+		break;
+	case MeshFormat::BinaryStl:
+		writeStl(source, buffer, level);
+		break;
+	}
+	buffer.flush();
+
+	if (!writer.finish()) {
+		LOG_ERROR("MeshExporter::write: writing ", path, " failed");
+		return false;
+	}
+	LOG_DEBUG("MeshExporter::write: ", path, ", level ", level, ", ", source.faceEnd() - source.faceBegin(), " faces");
+	return true;
+}
+} /// namespace lillugsi::planet
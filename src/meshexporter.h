@@ -0,0 +1,40 @@
+#pragma once
+
+#include "faceid.h"
+#include <string>
+
+namespace lillugsi::planet {
+class Icosphere;
+
+enum class MeshFormat {
+	Obj,       /// Text, 1-based indices
+	Ply,       /// binary_little_endian, optionally with a per-face data property
+	BinaryStl  /// Unindexed triangles with face normals
+};
+
+struct ExportOptions {
+	/// Deepest level of the icosphere
+	static constexpr unsigned int LeafLevel = ~0u;
+
+	MeshFormat format{MeshFormat::Ply};
+	unsigned int level{LeafLevel}; /// Clamped to the deepest level
+	/// Base faces [firstBaseFace, endBaseFace) to export
+	FaceId firstBaseFace{0};
+	FaceId endBaseFace{20};
+	/// PLY only: write the face data as a float property "data"
+	bool faceData{false};
+};
+
+/// Streams one level of an Icosphere to a mesh file.
+/// Vertices and faces go out in fixed size chunks through a buffered writer,
+/// so memory use does not grow with the level. Faces are wound counterclockwise
+/// seen from outside.
+/// The whole sphere uses the shared vertex numbering of the level. A subset of base
+/// faces is exported per base face: each gets its own copy of its lattice vertices,
+/// so the vertices along the base edges between two exported base faces are duplicated.
+class MeshExporter {
+public:
+	/// Returns false and logs an error if the options are invalid or the file cannot be written
+	static bool write(const Icosphere& icosphere, const std::string& path, const ExportOptions& options = {});
+};
+} /// namespace lillugsi::planet
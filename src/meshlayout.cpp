@@ -0,0 +1,67 @@
+#include "meshlayout.h"
+#include "icosphere.h"
+#include "cellid.h"
+#include "log.h"
+
+#include <algorithm> /// For std::min
+#include <limits>
+
+namespace lillugsi::planet {
+MeshLayout::MeshLayout(const Icosphere& icosphere, const unsigned int level, const FaceOrder order)
+: order(order) {
+	if (icosphere.getLevelCount() == 0) {
+		LOG_ERROR("MeshLayout: the icosphere has no faces");
+		return;
+	}
+	this->level = std::min(level, icosphere.getLevelCount() - 1);
+	const FaceStore& faces = icosphere.getFaces();
+	const FaceId begin = faces.getLevelBegin(this->level);
+	const FaceId end = faces.getLevelEnd(this->level);
+
+	if (order == FaceOrder::Curve) {
+		this->faceIds = CellId::getCurveOrder(this->level);
+	} else {
+		this->faceIds.reserve(end - begin);
+		for (FaceId id = begin; id < end; ++id) {
+			this->faceIds.push_back(id);
+		}
+	}
+	this->positions.resize(this->faceIds.size());
+	for (std::size_t position = 0; position < this->faceIds.size(); ++position) {
+		this->positions[this->faceIds[position] - begin] = static_cast<unsigned int>(position);
+	}
+
+	/// Vertices: the stored prefix of the level as is, or renumbered in order of first use
+	const VertexView source = icosphere.getLevelVertices(this->level);
+	constexpr unsigned int Unassigned = std::numeric_limits<unsigned int>::max();
+	std::vector<unsigned int> renumbered;
+	if (order == FaceOrder::Curve)
+		renumbered.assign(source.size(), Unassigned);
+	this->vertices.resize(source.size());
+	unsigned int nextVertex = 0;
+
+	this->indices.reserve(3 * this->faceIds.size());
+	this->neighbors.reserve(this->faceIds.size());
+	for (const FaceId id : this->faceIds) {
+		const FlatFace& face = faces[id];
+		for (const unsigned int vertex : face.vertexIndices) {
+			if (order == FaceOrder::FaceId) {
+				this->indices.push_back(vertex);
+				continue;
+			}
+			if (renumbered[vertex] == Unassigned) {
+				renumbered[vertex] = nextVertex;
+				this->vertices.set(nextVertex++, source[vertex]);
+			}
+			this->indices.push_back(renumbered[vertex]);
+		}
+		this->neighbors.push_back({this->getPosition(face.neighbors[0]), this->getPosition(face.neighbors[1]),
+			this->getPosition(face.neighbors[2])});
+	}
+	if (order == FaceOrder::FaceId) {
+		for (std::size_t vertex = 0; vertex < source.size(); ++vertex) {
+			this->vertices.set(vertex, source[vertex]);
+		}
+	}
+}
+} /// namespace lillugsi::planet
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "faceid.h"
+#include "vertexbuffer.h"
+#include <array>
+#include <span>
+#include <vector>
+
+namespace lillugsi::planet {
+class Icosphere;
+
+/// Order of the faces of a MeshLayout
+enum class FaceOrder {
+	FaceId, /// As stored: base face by base face, children in slot order, vertices as numbered
+	Curve   /// Along the CellId curve, vertices renumbered in order of first use
+};
+
+/// One level of an Icosphere copied into a cache friendly layout for scans and
+/// neighbor stencils. Faces are numbered by their position in the layout, and
+/// vertices, triangles and edge neighbors all refer to these positions.
+/// The FaceIds and the vertex numbering of the Icosphere are analytic and stay as
+/// they are, the layout maps between both with getFaceId and getPosition.
+///
+/// Along the curve consecutive faces share a vertex, and renumbering the vertices by
+/// first use keeps the corners of nearby faces in nearby cache lines. The stored
+/// numbering instead places the vertices of each level edge direction by edge
+/// direction, so the three corners of a face lie far apart.
+class MeshLayout {
+public:
+	/// Layout of a level (clamped to the deepest stored level)
+	MeshLayout(const Icosphere& icosphere, unsigned int level, FaceOrder order);
+
+	[[nodiscard]] unsigned int getLevel() const { return this->level; }
+	[[nodiscard]] FaceOrder getOrder() const { return this->order; }
+	[[nodiscard]] std::size_t getFaceCount() const { return this->faceIds.size(); }
+
+	/// FaceId of the face at a position, and back
+	[[nodiscard]] FaceId getFaceId(const std::size_t position) const { return this->faceIds[position]; }
+	[[nodiscard]] unsigned int getPosition(const FaceId id) const {
+		return this->positions[id - faceid::levelOffset(this->level)];
+	}
+	[[nodiscard]] std::span<const FaceId> getFaceIds() const { return this->faceIds; }
+
+	/// Vertices in layout numbering, three indices per face position, in the stored winding
+	[[nodiscard]] const VertexBuffer& getVertices() const { return this->vertices; }
+	[[nodiscard]] std::span<const unsigned int> getIndices() const { return this->indices; }
+	/// Layout positions of the edge neighbors of each face, neighbors[k] across edge k
+	[[nodiscard]] std::span<const std::array<unsigned int, 3>> getNeighbors() const { return this->neighbors; }
+
+private:
+	unsigned int level{0};
+	FaceOrder order;
+	std::vector<FaceId> faceIds;
+	std::vector<unsigned int> positions; /// By FaceId - levelOffset(level)
+	VertexBuffer vertices;
+	std::vector<unsigned int> indices;
+	std::vector<std::array<unsigned int, 3>> neighbors;
+};
+} /// namespace lillugsi::planet
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace lillugsi::planet {
+/// Resolves a requested thread count, 0 means one thread per hardware thread
+inline unsigned int resolveThreadCount(const unsigned int threadCount) {
+	if (threadCount != 0)
+		return threadCount;
+	return std::max(1u, std::thread::hardware_concurrency());
+}
+
+/// Fork-join loop over [begin, end): the range is cut into one contiguous chunk
+/// per thread and function(chunkBegin, chunkEnd) runs for each chunk. The calling
+/// thread takes the first chunk, the call returns when all chunks are done.
+template <typename Index, typename Function>
+void parallelForRanges(const Index begin, const Index end, unsigned int threadCount, Function&& function) {
+	if (end <= begin)
+		return;
+	const auto count = static_cast<std::size_t>(end - begin);
+	threadCount = static_cast<unsigned int>(std::min<std::size_t>(resolveThreadCount(threadCount), count));
+	if (threadCount <= 1) {
+		function(begin, end);
+		return;
+	}
+
+	const std::size_t chunk = (count + threadCount - 1) / threadCount;
+	std::vector<std::thread> workers;
+	workers.reserve(threadCount - 1);
+	for (unsigned int thread = 1; thread < threadCount; ++thread) {
+		const std::size_t chunkBegin = std::min(count, thread * chunk);
+		const std::size_t chunkEnd = std::min(count, chunkBegin + chunk);
+		if (chunkBegin == chunkEnd)
+			break;
+		workers.emplace_back([&function, begin, chunkBegin, chunkEnd]() {
+			function(static_cast<Index>(begin + chunkBegin), static_cast<Index>(begin + chunkEnd));
+		});
+	}
+	function(begin, static_cast<Index>(begin + std::min(count, chunk)));
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
+} /// namespace lillugsi::planet
@@ -0,0 +1,272 @@
+#include "pointlocator.h"
+#include "parallel.h"
+#include "simd.h"
+
+#include <algorithm> /// For std::min and std::fill
+
+namespace lillugsi::planet {
+namespace {
+/// z component of the 2D cross product of (b - a) and (c - a)
+template <typename Point>
+auto orientation(const Point& a, const Point& b, const Point& c) {
+	return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+}
+
+/// Projected point in SoA form, one lane per point
+struct Point2Batch {
+	simd::FloatBatch x, y;
+};
+
+/// The frame of one base face broadcast to all lanes
+struct FrameBatch {
+	simd::Vector3Batch normal, u, v;
+};
+
+/// Same operation order as PointLocator::project, so both paths round identically
+Point2Batch projectBatch(const FrameBatch& frame, const simd::Vector3Batch& point) {
+	const simd::FloatBatch scale = simd::FloatBatch::broadcast(1.0f) / frame.normal.dot(point);
+	return {point.dot(frame.u) * scale, point.dot(frame.v) * scale};
+}
+} /// namespace
+
+PointLocator::PointLocator(const VertexBuffer& vertices, const FaceStore& faces) {
+	for (FaceId baseFace = 0; baseFace < this->frames.size(); ++baseFace) {
+		const auto& vertexIndices = faces[baseFace].vertexIndices;
+		const Vector3 v0 = vertices[vertexIndices[0]];
+		const Vector3 v1 = vertices[vertexIndices[1]];
+		const Vector3 v2 = vertices[vertexIndices[2]];
+
+		/// The icosahedron is regular, so the centroid direction is the plane normal
+		Frame& frame = this->frames[baseFace];
+		frame.normal = (v0 + v1 + v2).normalized();
+		const Vector3 edge = v1 - v0;
+		frame.u = (edge - frame.normal * edge.dot(frame.normal)).normalized();
+		frame.v = frame.normal.cross(frame.u);
+	}
+}
+
+FaceId PointLocator::locateBaseFace(const Vector3& point) const {
+	FaceId best = InvalidFaceId;
+	float bestDot = 0.0f;
+	for (FaceId baseFace = 0; baseFace < this->frames.size(); ++baseFace) {
+		const float dot = this->frames[baseFace].normal.dot(point);
+		if (dot > bestDot) {
+			bestDot = dot;
+			best = baseFace;
+		}
+	}
+	return best;
+}
+
+FaceId PointLocator::locate(const Vector3& point, unsigned int level,
+	const VertexBuffer& vertices, const FaceStore& faces, stats::LocalCounts& counts) const {
+	FaceId face = this->locateBaseFace(point);
+	if (face == InvalidFaceId || faces.getLevelCount() == 0)
+		return InvalidFaceId;
+	level = std::min(level, faces.getLevelCount() - 1);
+
+	const Frame& frame = this->frames[face];
+	const Point2 target = project(frame, point);
+
+	/// Track the index within the level, childOf would recompute the level every step
+	FaceId localIndex = face;
+	for (unsigned int depth = 0; depth < level; ++depth) {
+		/// The center child is made of the three edge midpoints (stored as mid3, mid2, mid1),
+		/// mid2 lies opposite corner 0, mid3 opposite corner 1 and mid1 opposite corner 2
+		const auto& midpoints = faces[faceid::levelOffset(depth + 1) + 4 * localIndex + 3].vertexIndices;
+		const Point2 mid3 = project(frame, vertices[midpoints[0]]);
+		const Point2 mid2 = project(frame, vertices[midpoints[1]]);
+		const Point2 mid1 = project(frame, vertices[midpoints[2]]);
+
+		/// Unnormalized barycentric coordinates of the point in the center child,
+		/// multiplied by the sign of its area they are negative outside the matching edge
+		const float area = orientation(mid1, mid2, mid3);
+		const float sign = area < 0.0f ? -1.0f : 1.0f;
+		const std::array<float, 3> weights = {
+			orientation(target, mid3, mid1) * sign, /// opposite mid2 -> corner 0
+			orientation(target, mid1, mid2) * sign, /// opposite mid3 -> corner 1
+			orientation(target, mid2, mid3) * sign  /// opposite mid1 -> corner 2
+		};
+
+		unsigned int slot = 3;
+		float lowest = 0.0f;
+		for (unsigned int corner = 0; corner < 3; ++corner) {
+			if (weights[corner] < lowest) {
+				lowest = weights[corner];
+				slot = corner;
+			}
+		}
+		localIndex = 4 * localIndex + slot;
+	}
+	counts.add(stats::Counter::TriangleTests, level);
+	return faceid::levelOffset(level) + localIndex;
+}
+
+void PointLocator::locatePoints(const std::span<const Vector3> points, const std::span<FaceId> faceIds,
+	unsigned int level, const VertexBuffer& vertices, const FaceStore& faces, stats::Recorder& recorder,
+	const unsigned int threadCount) const {
+	const std::size_t count = std::min(points.size(), faceIds.size());
+	if (faces.getLevelCount() == 0) {
+		std::fill(faceIds.begin(), faceIds.begin() + count, InvalidFaceId);
+		return;
+	}
+	level = std::min(level, faces.getLevelCount() - 1);
+
+	std::vector<std::uint8_t> baseFaces(count);
+	parallelForRanges(std::size_t{0}, count, threadCount, [&](const std::size_t begin, const std::size_t end) {
+		this->locateBaseFaces(points, baseFaces, begin, end);
+	});
+
+	/// Counting sort by base face, bin 20 collects the zero vectors
+	std::array<std::size_t, 22> binBegin{};
+	for (const std::uint8_t baseFace : baseFaces) {
+		++binBegin[baseFace + 1];
+	}
+	for (std::size_t bin = 1; bin < binBegin.size(); ++bin) {
+		binBegin[bin] += binBegin[bin - 1];
+	}
+	std::vector<std::size_t> order(count);
+	std::array<std::size_t, 21> cursor{};
+	std::copy(binBegin.begin(), binBegin.end() - 1, cursor.begin());
+	for (std::size_t i = 0; i < count; ++i) {
+		order[cursor[baseFaces[i]]++] = i;
+	}
+	for (std::size_t i = binBegin[NoBaseFace]; i < count; ++i) {
+		faceIds[order[i]] = InvalidFaceId;
+	}
+
+	/// Threads get contiguous slices of the sorted order, a slice can span several bins
+	parallelForRanges(std::size_t{0}, binBegin[NoBaseFace], threadCount, [&](std::size_t begin, const std::size_t end) {
+		stats::LocalCounts counts;
+		while (begin < end) {
+			const FaceId baseFace = baseFaces[order[begin]];
+			const std::size_t segmentEnd = std::min(end, binBegin[baseFace + 1]);
+			this->descend(baseFace, order.data() + begin, segmentEnd - begin, level, points, faceIds, vertices, faces,
+				counts);
+			begin = segmentEnd;
+		}
+		counts.flushTo(recorder);
+	});
+}
+
+void PointLocator::locateBaseFaces(const std::span<const Vector3> points, const std::span<std::uint8_t> baseFaces,
+	const std::size_t begin, const std::size_t end) const {
+	using simd::FloatBatch;
+	constexpr unsigned int Width = FloatBatch::Width;
+	alignas(32) float x[Width], y[Width], z[Width], result[Width];
+
+	for (std::size_t first = begin; first < end; first += Width) {
+		const std::size_t lanes = std::min<std::size_t>(Width, end - first);
+		for (unsigned int lane = 0; lane < Width; ++lane) {
+			/// Padding lanes see the zero vector and are not written back
+			const Vector3 point = lane < lanes ? points[first + lane] : Vector3{};
+			x[lane] = point.x;
+			y[lane] = point.y;
+			z[lane] = point.z;
+		}
+		const simd::Vector3Batch point = simd::Vector3Batch::load(x, y, z);
+
+		/// Strict greater than from zero, like locateBaseFace
+		FloatBatch bestDot = FloatBatch::broadcast(0.0f);
+		FloatBatch best = FloatBatch::broadcast(static_cast<float>(NoBaseFace));
+		for (FaceId baseFace = 0; baseFace < this->frames.size(); ++baseFace) {
+			const Vector3& normal = this->frames[baseFace].normal;
+			const FloatBatch dot = simd::Vector3Batch::broadcast(normal.x, normal.y, normal.z).dot(point);
+			const FloatBatch greater = greaterThan(dot, bestDot);
+			bestDot = select(greater, dot, bestDot);
+			best = select(greater, FloatBatch::broadcast(static_cast<float>(baseFace)), best);
+		}
+		best.store(result);
+		for (std::size_t lane = 0; lane < lanes; ++lane) {
+			baseFaces[first + lane] = static_cast<std::uint8_t>(result[lane]);
+		}
+	}
+}
+
+void PointLocator::descend(const FaceId baseFace, const std::size_t* order, const std::size_t count,
+	const unsigned int level, const std::span<const Vector3> points, const std::span<FaceId> faceIds,
+	const VertexBuffer& vertices, const FaceStore& faces, stats::LocalCounts& counts) const {
+	using simd::FloatBatch;
+	constexpr unsigned int Width = FloatBatch::Width;
+
+	const Frame& frame = this->frames[baseFace];
+	const FrameBatch frameBatch = {
+		simd::Vector3Batch::broadcast(frame.normal.x, frame.normal.y, frame.normal.z),
+		simd::Vector3Batch::broadcast(frame.u.x, frame.u.y, frame.u.z),
+		simd::Vector3Batch::broadcast(frame.v.x, frame.v.y, frame.v.z)};
+	const FloatBatch zero = FloatBatch::broadcast(0.0f);
+	const FloatBatch one = FloatBatch::broadcast(1.0f);
+	const FloatBatch minusOne = FloatBatch::broadcast(-1.0f);
+
+	/// Gather buffers: the target and the three center child midpoints of every lane
+	alignas(32) float coordinates[4][3][Width];
+	alignas(32) float slots[Width];
+	FaceId localIndices[Width];
+
+	for (std::size_t first = 0; first < count; first += Width) {
+		const std::size_t lanes = std::min<std::size_t>(Width, count - first);
+		for (unsigned int lane = 0; lane < Width; ++lane) {
+			/// Padding lanes repeat the first point so they stay finite
+			const Vector3& point = points[order[first + (lane < lanes ? lane : 0)]];
+			coordinates[0][0][lane] = point.x;
+			coordinates[0][1][lane] = point.y;
+			coordinates[0][2][lane] = point.z;
+			localIndices[lane] = baseFace;
+		}
+		const Point2Batch target = projectBatch(frameBatch,
+			simd::Vector3Batch::load(coordinates[0][0], coordinates[0][1], coordinates[0][2]));
+
+		for (unsigned int depth = 0; depth < level; ++depth) {
+			const FaceId centerOffset = faceid::levelOffset(depth + 1) + 3;
+			for (unsigned int lane = 0; lane < Width; ++lane) {
+				/// Stored as mid3, mid2, mid1
+				const auto& midpoints = faces[centerOffset + 4 * localIndices[lane]].vertexIndices;
+				for (unsigned int corner = 0; corner < 3; ++corner) {
+					coordinates[corner + 1][0][lane] = vertices.getX()[midpoints[corner]];
+					coordinates[corner + 1][1][lane] = vertices.getY()[midpoints[corner]];
+					coordinates[corner + 1][2][lane] = vertices.getZ()[midpoints[corner]];
+				}
+			}
+			std::array<Point2Batch, 3> projected{};
+			for (unsigned int corner = 0; corner < 3; ++corner) {
+				const auto& midpoint = coordinates[corner + 1];
+				projected[corner] = projectBatch(frameBatch, simd::Vector3Batch::load(midpoint[0], midpoint[1], midpoint[2]));
+			}
+			const Point2Batch& mid3 = projected[0];
+			const Point2Batch& mid2 = projected[1];
+			const Point2Batch& mid1 = projected[2];
+
+			/// Same weights and tie breaking as the scalar locate
+			const FloatBatch area = orientation(mid1, mid2, mid3);
+			const FloatBatch sign = select(lessThan(area, zero), minusOne, one);
+			const std::array<FloatBatch, 3> weights = {
+				orientation(target, mid3, mid1) * sign,
+				orientation(target, mid1, mid2) * sign,
+				orientation(target, mid2, mid3) * sign};
+
+			FloatBatch slot = FloatBatch::broadcast(3.0f);
+			FloatBatch lowest = zero;
+			for (unsigned int corner = 0; corner < 3; ++corner) {
+				const FloatBatch lower = lessThan(weights[corner], lowest);
+				lowest = select(lower, weights[corner], lowest);
+				slot = select(lower, FloatBatch::broadcast(static_cast<float>(corner)), slot);
+			}
+			slot.store(slots);
+			for (unsigned int lane = 0; lane < Width; ++lane) {
+				localIndices[lane] = 4 * localIndices[lane] + static_cast<FaceId>(slots[lane]);
+			}
+		}
+		/// Padding lanes are not counted
+		counts.add(stats::Counter::TriangleTests, lanes * level);
+
+		for (std::size_t lane = 0; lane < lanes; ++lane) {
+			faceIds[order[first + lane]] = faceid::levelOffset(level) + localIndices[lane];
+		}
+	}
+}
+
+PointLocator::Point2 PointLocator::project(const Frame& frame, const Vector3& point) {
+	const float scale = 1.0f / frame.normal.dot(point);
+	return {point.dot(frame.u) * scale, point.dot(frame.v) * scale};
+}
+} /// namespace lillugsi::planet
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "vector3.h"
+#include "vertexbuffer.h"
+#include "faceid.h"
+#include "facestore.h"
+#include "icospherestats.h"
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace lillugsi::planet {
+/// Point to face location in O(level).
+/// The base face is the one whose plane normal has the largest dot product with
+/// the point. Below it all work happens in the gnomonic projection onto that base
+/// plane, where the great-circle edges of every subdivided face are straight lines:
+/// per level the point gets 2D barycentric coordinates relative to the center child,
+/// a negative one names the corner child that contains it.
+class PointLocator {
+public:
+	PointLocator() = default;
+	/// Builds the 20 base face frames from the level 0 faces
+	PointLocator(const VertexBuffer& vertices, const FaceStore& faces);
+
+	/// Base face hit by the ray from the center through the point
+	[[nodiscard]] FaceId locateBaseFace(const Vector3& point) const;
+
+	/// Face containing the point on the given level (clamped to the deepest stored level),
+	/// InvalidFaceId for the zero vector. Adds one TriangleTests count per level descended.
+	[[nodiscard]] FaceId locate(const Vector3& point, unsigned int level,
+		const VertexBuffer& vertices, const FaceStore& faces, stats::LocalCounts& counts) const;
+
+	/// Batched locate, faceIds[i] gets the same face as locate(points[i], level).
+	/// Points are binned by base face so each bin shares one frame, then walked down
+	/// simd::FloatBatch::Width at a time in SoA form. Bins are split across threadCount
+	/// threads (0 = one per hardware thread). Only min(points, faceIds) entries are written.
+	/// Each thread adds its TriangleTests to the recorder once.
+	void locatePoints(std::span<const Vector3> points, std::span<FaceId> faceIds, unsigned int level,
+		const VertexBuffer& vertices, const FaceStore& faces, stats::Recorder& recorder,
+		unsigned int threadCount = 1) const;
+
+private:
+	struct Point2 {
+		float x, y;
+	};
+
+	/// Orthonormal frame of a base face plane
+	struct Frame {
+		Vector3 normal;
+		Vector3 u;
+		Vector3 v;
+	};
+
+	[[nodiscard]] static Point2 project(const Frame& frame, const Vector3& point);
+
+	/// Base face of each point in [begin, end), NoBaseFace for the zero vector
+	void locateBaseFaces(std::span<const Vector3> points, std::span<std::uint8_t> baseFaces,
+		std::size_t begin, std::size_t end) const;
+	/// Descends the points order[0..count), which all lie in baseFace, down to level
+	void descend(FaceId baseFace, const std::size_t* order, std::size_t count, unsigned int level,
+		std::span<const Vector3> points, std::span<FaceId> faceIds,
+		const VertexBuffer& vertices, const FaceStore& faces, stats::LocalCounts& counts) const;
+
+	static constexpr std::uint8_t NoBaseFace = 20;
+
+	std::array<Frame, 20> frames{};
+};
+} /// namespace lillugsi::planet
@@ -0,0 +1,126 @@
+#pragma once
+
+/// Thin wrapper over the widest float vector the build targets:
+/// AVX (8 lanes) if compiled with -mavx, SSE2 (4 lanes) on any x86-64,
+/// otherwise a scalar fallback with one lane. Comparisons return masks that
+/// are only meant to be passed to select.
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LILLUGSI_SIMD_SSE2
+#else
+#include <cmath>
+#endif
+
+namespace lillugsi::planet::simd {
+#if defined(__AVX__)
+constexpr const char* InstructionSet = "AVX";
+
+struct FloatBatch {
+	static constexpr unsigned int Width = 8;
+	__m256 value;
+
+	static FloatBatch load(const float* data) { return {_mm256_loadu_ps(data)}; }
+	static FloatBatch broadcast(const float scalar) { return {_mm256_set1_ps(scalar)}; }
+	void store(float* data) const { _mm256_storeu_ps(data, this->value); }
+
+	friend FloatBatch operator+(const FloatBatch a, const FloatBatch b) { return {_mm256_add_ps(a.value, b.value)}; }
+	friend FloatBatch operator-(const FloatBatch a, const FloatBatch b) { return {_mm256_sub_ps(a.value, b.value)}; }
+	friend FloatBatch operator*(const FloatBatch a, const FloatBatch b) { return {_mm256_mul_ps(a.value, b.value)}; }
+	friend FloatBatch operator/(const FloatBatch a, const FloatBatch b) { return {_mm256_div_ps(a.value, b.value)}; }
+	friend FloatBatch sqrt(const FloatBatch a) { return {_mm256_sqrt_ps(a.value)}; }
+	friend FloatBatch lessThan(const FloatBatch a, const FloatBatch b) { return {_mm256_cmp_ps(a.value, b.value, _CMP_LT_OQ)}; }
+	friend FloatBatch greaterThan(const FloatBatch a, const FloatBatch b) { return {_mm256_cmp_ps(a.value, b.value, _CMP_GT_OQ)}; }
+	/// mask ? a : b per lane
+	friend FloatBatch select(const FloatBatch mask, const FloatBatch a, const FloatBatch b) {
+		return {_mm256_blendv_ps(b.value, a.value, mask.value)};
+	}
+};
+#elif defined(LILLUGSI_SIMD_SSE2)
+constexpr const char* InstructionSet = "SSE2";
+
+struct FloatBatch {
+	static constexpr unsigned int Width = 4;
+	__m128 value;
+
+	static FloatBatch load(const float* data) { return {_mm_loadu_ps(data)}; }
+	static FloatBatch broadcast(const float scalar) { return {_mm_set1_ps(scalar)}; }
+	void store(float* data) const { _mm_storeu_ps(data, this->value); }
+
+	friend FloatBatch operator+(const FloatBatch a, const FloatBatch b) { return {_mm_add_ps(a.value, b.value)}; }
+	friend FloatBatch operator-(const FloatBatch a, const FloatBatch b) { return {_mm_sub_ps(a.value, b.value)}; }
+	friend FloatBatch operator*(const FloatBatch a, const FloatBatch b) { return {_mm_mul_ps(a.value, b.value)}; }
+	friend FloatBatch operator/(const FloatBatch a, const FloatBatch b) { return {_mm_div_ps(a.value, b.value)}; }
+	friend FloatBatch sqrt(const FloatBatch a) { return {_mm_sqrt_ps(a.value)}; }
+	friend FloatBatch lessThan(const FloatBatch a, const FloatBatch b) { return {_mm_cmplt_ps(a.value, b.value)}; }
+	friend FloatBatch greaterThan(const FloatBatch a, const FloatBatch b) { return {_mm_cmpgt_ps(a.value, b.value)}; }
+	/// mask ? a : b per lane
+	friend FloatBatch select(const FloatBatch mask, const FloatBatch a, const FloatBatch b) {
+		return {_mm_or_ps(_mm_and_ps(mask.value, a.value), _mm_andnot_ps(mask.value, b.value))};
+	}
+};
+#else
+constexpr const char* InstructionSet = "scalar";
+
+struct FloatBatch {
+	static constexpr unsigned int Width = 1;
+	float value;
+
+	static FloatBatch load(const float* data) { return {*data}; }
+	static FloatBatch broadcast(const float scalar) { return {scalar}; }
+	void store(float* data) const { *data = this->value; }
+
+	friend FloatBatch operator+(const FloatBatch a, const FloatBatch b) { return {a.value + b.value}; }
+	friend FloatBatch operator-(const FloatBatch a, const FloatBatch b) { return {a.value - b.value}; }
+	friend FloatBatch operator*(const FloatBatch a, const FloatBatch b) { return {a.value * b.value}; }
+	friend FloatBatch operator/(const FloatBatch a, const FloatBatch b) { return {a.value / b.value}; }
+	friend FloatBatch sqrt(const FloatBatch a) { return {std::sqrt(a.value)}; }
+	friend FloatBatch lessThan(const FloatBatch a, const FloatBatch b) { return {a.value < b.value ? 1.0f : 0.0f}; }
+	friend FloatBatch greaterThan(const FloatBatch a, const FloatBatch b) { return {a.value > b.value ? 1.0f : 0.0f}; }
+	/// mask ? a : b
+	friend FloatBatch select(const FloatBatch mask, const FloatBatch a, const FloatBatch b) {
+		return mask.value != 0.0f ? a : b;
+	}
+};
+#endif
+
+/// Vectors in SoA form, lane n of x, y and z is one Vector3.
+/// Operation order matches Vector3, so both round identically.
+struct Vector3Batch {
+	FloatBatch x, y, z;
+
+	static Vector3Batch load(const float* x, const float* y, const float* z) {
+		return {FloatBatch::load(x), FloatBatch::load(y), FloatBatch::load(z)};
+	}
+	static Vector3Batch broadcast(const float x, const float y, const float z) {
+		return {FloatBatch::broadcast(x), FloatBatch::broadcast(y), FloatBatch::broadcast(z)};
+	}
+	void store(float* x, float* y, float* z) const {
+		this->x.store(x);
+		this->y.store(y);
+		this->z.store(z);
+	}
+
+	friend Vector3Batch operator+(const Vector3Batch& a, const Vector3Batch& b) { return {a.x + b.x, a.y + b.y, a.z + b.z}; }
+	friend Vector3Batch operator-(const Vector3Batch& a, const Vector3Batch& b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+	friend Vector3Batch operator*(const Vector3Batch& a, const FloatBatch scalar) { return {a.x * scalar, a.y * scalar, a.z * scalar}; }
+
+	[[nodiscard]] FloatBatch dot(const Vector3Batch& other) const {
+		return this->x * other.x + this->y * other.y + this->z * other.z;
+	}
+	[[nodiscard]] Vector3Batch cross(const Vector3Batch& other) const {
+		return {this->y * other.z - this->z * other.y,
+			this->z * other.x - this->x * other.z,
+			this->x * other.y - this->y * other.x};
+	}
+	/// Zero vectors stay as they are, like Vector3::normalized
+	[[nodiscard]] Vector3Batch normalized() const {
+		const FloatBatch length = sqrt(this->dot(*this));
+		const FloatBatch nonZero = greaterThan(length, FloatBatch::broadcast(0.0f));
+		return {select(nonZero, this->x / length, this->x),
+			select(nonZero, this->y / length, this->y),
+			select(nonZero, this->z / length, this->z)};
+	}
+};
+} /// namespace lillugsi::planet::simd
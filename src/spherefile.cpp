@@ -0,0 +1,236 @@
+#include "spherefile.h"
+#include "icosphere.h"
+#include "vertexnumbering.h"
+#include "filewriter.h"
+#include "log.h"
+
+#include <algorithm> /// For std::min
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#if defined(_WIN32)
+#include <new>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace lillugsi::planet {
+namespace {
+static_assert(std::is_trivially_copyable_v<FlatFace>, "FlatFace is written and mapped as raw bytes");
+static_assert(std::is_trivially_copyable_v<SphereFileHeader>);
+
+constexpr std::uint64_t SectionAlignment = 64;
+
+constexpr std::uint64_t alignSection(const std::uint64_t offset) {
+	return (offset + SectionAlignment - 1) / SectionAlignment * SectionAlignment;
+}
+} /// namespace
+
+bool SphereFile::save(const Icosphere& icosphere, const std::string& path) {
+	const VertexBuffer& vertices = icosphere.getVertexBuffer();
+	const std::span<const unsigned int> indices = icosphere.getIndexBuffer();
+	const FaceStore& faces = icosphere.getFaces();
+
+	SphereFileHeader header{};
+	header.magic = Magic;
+	header.version = Version;
+	header.byteOrder = ByteOrderMark;
+	header.levelCount = faces.getLevelCount();
+	header.faceRecordSize = sizeof(FlatFace);
+	header.vertexCount = vertices.size();
+	header.faceCount = faces.size();
+	std::uint64_t offset = alignSection(sizeof(SphereFileHeader));
+	for (std::uint64_t& vertexOffset : header.vertexOffsets) {
+		vertexOffset = offset;
+		offset = alignSection(offset + header.vertexCount * sizeof(float));
+	}
+	header.indexOffset = offset;
+	offset = alignSection(offset + indices.size_bytes());
+	header.faceOffset = offset;
+	header.fileSize = offset + header.faceCount * sizeof(FlatFace);
+
+	FileWriter writer(path);
+	if (!writer.isOpen()) {
+		LOG_ERROR("SphereFile::save: cannot open ", path, ": ", std::strerror(errno));
+		return false;
+	}
+	writer.write(&header, sizeof(header));
+	const std::array<std::span<const float>, 3> components = {vertices.getX(), vertices.getY(), vertices.getZ()};
+	for (unsigned int axis = 0; axis < 3; ++axis) {
+		writer.padTo(header.vertexOffsets[axis]);
+		writer.write(components[axis].data(), components[axis].size_bytes());
+	}
+	writer.padTo(header.indexOffset);
+	writer.write(indices.data(), indices.size_bytes());
+	writer.padTo(header.faceOffset);
+
+	/// The records go out in chunks, in tree mode with the data of the Face nodes filled in
+	constexpr FaceId ChunkSize = 1 << 16;
+	std::vector<FlatFace> chunk;
+	for (FaceId begin = 0; begin < faces.size(); begin += ChunkSize) {
+		const FaceId end = std::min<FaceId>(faces.size(), begin + ChunkSize);
+		chunk.assign(&faces[begin], &faces[begin] + (end - begin));
+		if (icosphere.getFaceStorage() == FaceStorage::Tree) {
+			for (FaceId id = begin; id < end; ++id) {
+				chunk[id - begin].data = icosphere.getFaceData(id);
+			}
+		}
+		writer.write(chunk.data(), chunk.size() * sizeof(FlatFace));
+	}
+
+	if (!writer.finish()) {
+		LOG_ERROR("SphereFile::save: writing ", path, " failed");
+		return false;
+	}
+	LOG_DEBUG("SphereFile::save: ", path, ", ", header.levelCount, " levels, ", header.fileSize, " bytes");
+	return true;
+}
+
+std::unique_ptr<SphereFile> SphereFile::open(const std::string& path) {
+	std::unique_ptr<SphereFile> file(new SphereFile());
+
+#if defined(_WIN32)
+	/// No mapping here, read the file into one aligned block instead
+	std::FILE* stream = std::fopen(path.c_str(), "rb");
+	if (!stream) {
+		LOG_ERROR("SphereFile::open: cannot open ", path);
+		return nullptr;
+	}
+	std::fseek(stream, 0, SEEK_END);
+	file->size = static_cast<std::size_t>(std::ftell(stream));
+	std::fseek(stream, 0, SEEK_SET);
+	auto* buffer = static_cast<std::byte*>(::operator new(std::max<std::size_t>(file->size, 1),
+		std::align_val_t{SectionAlignment}));
+	file->data = buffer;
+	const bool complete = std::fread(buffer, 1, file->size, stream) == file->size;
+	std::fclose(stream);
+	if (!complete) {
+		LOG_ERROR("SphereFile::open: cannot read ", path);
+		return nullptr;
+	}
+#else
+	const int descriptor = ::open(path.c_str(), O_RDONLY);
+	if (descriptor < 0) {
+		LOG_ERROR("SphereFile::open: cannot open ", path, ": ", std::strerror(errno));
+		return nullptr;
+	}
+	struct stat status {};
+	if (::fstat(descriptor, &status) != 0 || status.st_size <= 0) {
+		LOG_ERROR("SphereFile::open: ", path, " is empty or cannot be read");
+		::close(descriptor);
+		return nullptr;
+	}
+	file->size = static_cast<std::size_t>(status.st_size);
+	void* mapping = ::mmap(nullptr, file->size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+	::close(descriptor); /// The mapping keeps the file alive
+	if (mapping == MAP_FAILED) {
+		LOG_ERROR("SphereFile::open: cannot map ", path, ": ", std::strerror(errno));
+		file->size = 0;
+		return nullptr;
+	}
+	file->data = static_cast<const std::byte*>(mapping);
+#endif
+
+	/// Header only: the sections are not touched, the OS pages them in on first use
+	if (file->size < sizeof(SphereFileHeader)) {
+		LOG_ERROR("SphereFile::open: ", path, " is too small for a header");
+		return nullptr;
+	}
+	file->header = reinterpret_cast<const SphereFileHeader*>(file->data);
+	const SphereFileHeader& header = *file->header;
+	const char* problem = nullptr;
+	if (header.magic != Magic)
+		problem = "not a sphere file";
+	else if (header.byteOrder != ByteOrderMark)
+		problem = "written with a different byte order";
+	else if (header.version != Version)
+		problem = "unsupported version";
+	else if (header.faceRecordSize != sizeof(FlatFace))
+		problem = "face record size differs from this build";
+	else if (header.levelCount == 0 || header.levelCount > faceid::MaxLevel + 1)
+		problem = "invalid level count";
+	else if (header.vertexCount != VertexNumbering::vertexCount(header.levelCount - 1)
+		|| header.faceCount != faceid::levelOffset(header.levelCount))
+		problem = "counts do not match the level count";
+	else if (header.fileSize != file->size
+		|| header.vertexOffsets[0] % SectionAlignment != 0 || header.vertexOffsets[1] % SectionAlignment != 0
+		|| header.vertexOffsets[2] % SectionAlignment != 0 || header.indexOffset % SectionAlignment != 0
+		|| header.faceOffset % SectionAlignment != 0
+		|| header.vertexOffsets[0] < sizeof(SphereFileHeader)
+		|| header.vertexOffsets[0] + header.vertexCount * sizeof(float) > header.vertexOffsets[1]
+		|| header.vertexOffsets[1] + header.vertexCount * sizeof(float) > header.vertexOffsets[2]
+		|| header.vertexOffsets[2] + header.vertexCount * sizeof(float) > header.indexOffset
+		|| header.indexOffset + 3 * header.faceCount * sizeof(unsigned int) > header.faceOffset
+		|| header.faceOffset + header.faceCount * sizeof(FlatFace) > header.fileSize)
+		problem = "sections do not fit the file";
+	if (problem) {
+		LOG_ERROR("SphereFile::open: ", path, ": ", problem);
+		return nullptr;
+	}
+
+	LOG_DEBUG("SphereFile::open: ", path, ", ", header.levelCount, " levels, ", header.fileSize, " bytes");
+	return file;
+}
+
+SphereFile::~SphereFile() {
+	if (!this->data)
+		return;
+#if defined(_WIN32)
+	::operator delete(const_cast<std::byte*>(this->data), std::align_val_t{SectionAlignment});
+#else
+	::munmap(const_cast<std::byte*>(this->data), this->size);
+#endif
+}
+
+template <typename T>
+const T* SphereFile::at(const std::uint64_t offset) const {
+	return reinterpret_cast<const T*>(this->data + offset);
+}
+
+VertexView SphereFile::getVertices() const {
+	const auto count = static_cast<std::size_t>(this->header->vertexCount);
+	return {{this->at<float>(this->header->vertexOffsets[0]), count},
+		{this->at<float>(this->header->vertexOffsets[1]), count},
+		{this->at<float>(this->header->vertexOffsets[2]), count}};
+}
+
+VertexView SphereFile::getLevelVertices(const unsigned int level) const {
+	if (level >= this->getLevelCount())
+		return {};
+	const VertexView vertices = this->getVertices();
+	const auto count = static_cast<std::size_t>(VertexNumbering::vertexCount(level));
+	return {vertices.x.first(count), vertices.y.first(count), vertices.z.first(count)};
+}
+
+std::span<const unsigned int> SphereFile::getIndices() const {
+	return {this->at<unsigned int>(this->header->indexOffset), 3 * static_cast<std::size_t>(this->header->faceCount)};
+}
+
+std::span<const unsigned int> SphereFile::getLevelIndices(const unsigned int level) const {
+	if (level >= this->getLevelCount())
+		return {};
+	const std::size_t begin = 3 * static_cast<std::size_t>(faceid::levelOffset(level));
+	const std::size_t end = 3 * static_cast<std::size_t>(faceid::levelOffset(level + 1));
+	return this->getIndices().subspan(begin, end - begin);
+}
+
+std::span<const unsigned int> SphereFile::getLeafIndices() const {
+	return this->getLevelIndices(this->getLevelCount() - 1);
+}
+
+std::span<const FlatFace> SphereFile::getFaces() const {
+	return {this->at<FlatFace>(this->header->faceOffset), static_cast<std::size_t>(this->header->faceCount)};
+}
+
+std::span<const FlatFace> SphereFile::getLevelFaces(const unsigned int level) const {
+	if (level >= this->getLevelCount())
+		return {};
+	return this->getFaces().subspan(faceid::levelOffset(level), faceid::levelFaceCount(level));
+}
+} /// namespace lillugsi::planet
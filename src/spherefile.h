@@ -0,0 +1,80 @@
+#pragma once
+
+#include "faceid.h"
+#include "facestore.h"
+#include "vertexbuffer.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+
+namespace lillugsi::planet {
+class Icosphere;
+
+/// Fixed size header at offset 0 of a sphere file. Every section starts on a
+/// 64-byte boundary and is stored in the in-memory layout of this build, so a
+/// mapped file is used in place:
+///   x, y, z      vertexCount floats each (VertexBuffer components)
+///   indices      3 * faceCount unsigned ints, laid out by FaceId
+///   faces        faceCount FlatFace records with neighbors and data
+struct SphereFileHeader {
+	std::array<char, 8> magic;
+	std::uint32_t version;
+	std::uint32_t byteOrder;      /// ByteOrderMark as written, differs on a foreign endianness
+	std::uint32_t levelCount;
+	std::uint32_t faceRecordSize; /// sizeof(FlatFace)
+	std::uint64_t vertexCount;
+	std::uint64_t faceCount;
+	std::array<std::uint64_t, 3> vertexOffsets;
+	std::uint64_t indexOffset;
+	std::uint64_t faceOffset;
+	std::uint64_t fileSize;
+};
+
+/// Read-only memory mapped sphere file.
+/// open() maps the file and validates the header only, so it takes the same
+/// time at every level. All views point into the mapping and stay valid as
+/// long as the SphereFile lives.
+class SphereFile {
+public:
+	static constexpr std::array<char, 8> Magic{{'I', 'C', 'O', 'S', 'P', 'H', 'R', '\0'}};
+	static constexpr std::uint32_t Version = 1;
+	static constexpr std::uint32_t ByteOrderMark = 0x01020304;
+
+	/// Writes all levels of the icosphere, including the face data. Returns false
+	/// and logs an error if the file cannot be written.
+	static bool save(const Icosphere& icosphere, const std::string& path);
+	/// Maps a file written by save, nullptr if it cannot be opened or the header does not fit
+	[[nodiscard]] static std::unique_ptr<SphereFile> open(const std::string& path);
+
+	~SphereFile();
+	SphereFile(const SphereFile&) = delete;
+	SphereFile& operator=(const SphereFile&) = delete;
+
+	[[nodiscard]] const SphereFileHeader& getHeader() const { return *this->header; }
+	[[nodiscard]] unsigned int getLevelCount() const { return this->header->levelCount; }
+
+	/// Same layout as the matching Icosphere views
+	[[nodiscard]] VertexView getVertices() const;
+	[[nodiscard]] VertexView getLevelVertices(unsigned int level) const;
+	/// Triangles of all levels, 3 * FaceId is the first index of a face
+	[[nodiscard]] std::span<const unsigned int> getIndices() const;
+	[[nodiscard]] std::span<const unsigned int> getLevelIndices(unsigned int level) const;
+	[[nodiscard]] std::span<const unsigned int> getLeafIndices() const;
+	/// Face records of all levels, indexed by FaceId
+	[[nodiscard]] std::span<const FlatFace> getFaces() const;
+	[[nodiscard]] std::span<const FlatFace> getLevelFaces(unsigned int level) const;
+
+private:
+	SphereFile() = default;
+
+	template <typename T>
+	[[nodiscard]] const T* at(std::uint64_t offset) const;
+
+	const std::byte* data{nullptr};
+	std::size_t size{0};
+	const SphereFileHeader* header{nullptr};
+};
+} /// namespace lillugsi::planet
@@ -0,0 +1,66 @@
+#include "sphericalregion.h"
+#include "log.h"
+
+#include <algorithm> /// For std::min
+#include <cmath>
+#include <numbers>
+#include <utility>
+
+namespace lillugsi::planet {
+SphericalRegion::SphericalRegion(std::vector<HalfSpace> halfSpaces)
+: halfSpaces(std::move(halfSpaces)) {
+	for (HalfSpace& halfSpace : this->halfSpaces) {
+		halfSpace.normal.normalize();
+	}
+}
+
+SphericalRegion SphericalRegion::cap(const Vector3& center, const float angle) {
+	return SphericalRegion({{center, std::cos(std::min(angle, std::numbers::pi_v<float>))}});
+}
+
+SphericalRegion SphericalRegion::band(const Vector3& pole, const float minDot, const float maxDot) {
+	return SphericalRegion({{pole, minDot}, {pole * -1.0f, -maxDot}});
+}
+
+SphericalRegion SphericalRegion::polygon(const std::span<const Vector3> vertices) {
+	if (vertices.size() < 3) {
+		LOG_ERROR("SphericalRegion::polygon: ", vertices.size(), " vertices, at least 3 are needed");
+		return {};
+	}
+	/// The inside lies to the left of every edge
+	std::vector<HalfSpace> halfSpaces;
+	halfSpaces.reserve(vertices.size());
+	for (std::size_t index = 0; index < vertices.size(); ++index) {
+		const Vector3& from = vertices[index];
+		const Vector3& to = vertices[(index + 1) % vertices.size()];
+		halfSpaces.push_back({from.cross(to), 0.0f});
+	}
+	return SphericalRegion(std::move(halfSpaces));
+}
+
+SphericalRegion SphericalRegion::latLonBox(const float minLatitude, const float maxLatitude,
+	const float minLongitude, const float maxLongitude) {
+	if (maxLongitude - minLongitude > std::numbers::pi_v<float>)
+		LOG_WARN("SphericalRegion::latLonBox: longitude range wider than pi, the box is not convex");
+	SphericalRegion region = band(Vector3(0.0f, 0.0f, 1.0f), std::sin(minLatitude), std::sin(maxLatitude));
+	/// East of the first meridian, west of the second
+	region.halfSpaces.push_back({Vector3(-std::sin(minLongitude), std::cos(minLongitude), 0.0f), 0.0f});
+	region.halfSpaces.push_back({Vector3(std::sin(maxLongitude), -std::cos(maxLongitude), 0.0f), 0.0f});
+	return region;
+}
+
+SphericalRegion SphericalRegion::intersect(const SphericalRegion& other) const {
+	std::vector<HalfSpace> combined = this->halfSpaces;
+	combined.insert(combined.end(), other.halfSpaces.begin(), other.halfSpaces.end());
+	return SphericalRegion(std::move(combined));
+}
+
+bool SphericalRegion::contains(const Vector3& direction) const {
+	const Vector3 unit = direction.normalized();
+	for (const HalfSpace& halfSpace : this->halfSpaces) {
+		if (halfSpace.normal.dot(unit) < halfSpace.minDot)
+			return false;
+	}
+	return true;
+}
+} /// namespace lillugsi::planet
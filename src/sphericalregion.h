@@ -0,0 +1,44 @@
+#pragma once
+
+#include "vector3.h"
+#include <span>
+#include <vector>
+
+namespace lillugsi::planet {
+/// Directions p with dot(normal, p) >= minDot, a cap around normal.
+/// minDot 0 is a hemisphere bounded by a great circle.
+struct HalfSpace {
+	Vector3 normal;
+	float minDot;
+};
+
+/// Convex region of the unit sphere, the intersection of a few half spaces.
+/// Caps, bands and convex polygons are all of this form, so one face test serves
+/// every shape. Positions are directions, they need not be normalized.
+class SphericalRegion {
+public:
+	SphericalRegion() = default;
+	explicit SphericalRegion(std::vector<HalfSpace> halfSpaces);
+
+	/// All directions within angle (radians) of center
+	[[nodiscard]] static SphericalRegion cap(const Vector3& center, float angle);
+	/// All directions p with minDot <= dot(pole, p) <= maxDot, between two parallel planes.
+	/// A band of half width w around the great circle of pole is band(pole, -sin w, sin w).
+	[[nodiscard]] static SphericalRegion band(const Vector3& pole, float minDot, float maxDot);
+	/// Convex spherical polygon with great-circle edges, vertices counterclockwise seen from outside
+	[[nodiscard]] static SphericalRegion polygon(std::span<const Vector3> vertices);
+	/// Latitude/longitude box in radians, z is north and longitude 0 lies on +x towards +y.
+	/// The longitude range must not be wider than pi, query wider boxes as two.
+	[[nodiscard]] static SphericalRegion latLonBox(float minLatitude, float maxLatitude,
+		float minLongitude, float maxLongitude);
+
+	/// Intersection of both regions
+	[[nodiscard]] SphericalRegion intersect(const SphericalRegion& other) const;
+
+	[[nodiscard]] bool contains(const Vector3& direction) const;
+	[[nodiscard]] std::span<const HalfSpace> getHalfSpaces() const { return this->halfSpaces; }
+
+private:
+	std::vector<HalfSpace> halfSpaces;
+};
+} /// namespace lillugsi::planet
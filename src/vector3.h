@@ -1,37 +1,55 @@
 #pragma once
 
+#include <cmath> /// For std::sqrt
+
 namespace lillugsi::planet {
+/// Header-only so the operators inline into every caller,
+/// everything but the normalization is usable in constant expressions
 class Vector3 {
 public:
 	float x, y, z;
 
 	/// Constructors
-	Vector3();
-	Vector3(float x, float y, float z);
-
-	/// Destructor
-	~Vector3() = default;
-
-	/// Copy constructor
-	Vector3(const Vector3& other) = default;
-
-	/// Assignment operator
-	Vector3& operator=(const Vector3& other) = default;
+	constexpr Vector3() : x(0.0f), y(0.0f), z(0.0f) {}
+	constexpr Vector3(const float x, const float y, const float z) : x(x), y(y), z(z) {}
 
 	/// Vector operations
-	Vector3 operator+(const Vector3& other) const;
-	Vector3 operator-(const Vector3& other) const;
-	Vector3 operator*(float scalar) const;
+	constexpr Vector3 operator+(const Vector3& other) const {
+		return {this->x + other.x, this->y + other.y, this->z + other.z};
+	}
+	constexpr Vector3 operator-(const Vector3& other) const {
+		return {this->x - other.x, this->y - other.y, this->z - other.z};
+	}
+	constexpr Vector3 operator*(const float scalar) const {
+		return {this->x * scalar, this->y * scalar, this->z * scalar};
+	}
+	constexpr bool operator==(const Vector3& other) const = default;
 
 	/// Dot product
-	[[nodiscard]] float dot(const Vector3& other) const;
+	[[nodiscard]] constexpr float dot(const Vector3& other) const {
+		return this->x * other.x + this->y * other.y + this->z * other.z;
+	}
 
 	/// Cross product
-	[[nodiscard]] Vector3 cross(const Vector3& other) const;
-
-	/// Normalize the vector
-	void normalize();
-	[[nodiscard]] Vector3 normalized() const;
+	[[nodiscard]] constexpr Vector3 cross(const Vector3& other) const {
+		return {this->y * other.z - this->z * other.y,
+			this->z * other.x - this->x * other.z,
+			this->x * other.y - this->y * other.x};
+	}
+
+	[[nodiscard]] float length() const {
+		return std::sqrt(this->dot(*this));
+	}
+
+	/// Normalize the vector, the zero vector stays as it is
+	void normalize() {
+		*this = this->normalized();
+	}
+	[[nodiscard]] Vector3 normalized() const {
+		const float length = this->length();
+		if (length > 0.0f)
+			return {this->x / length, this->y / length, this->z / length};
+		return *this;
+	}
 };
 } /// namespace lillugsi::planet
-
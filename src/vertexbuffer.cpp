@@ -0,0 +1,114 @@
+#include "vertexbuffer.h"
+#include "simd.h"
+
+#include <algorithm> /// For std::min
+
+namespace lillugsi::planet {
+using simd::FloatBatch;
+using simd::Vector3Batch;
+
+void VertexBuffer::resize(const std::size_t count) {
+	this->x.resize(count);
+	this->y.resize(count);
+	this->z.resize(count);
+}
+
+void VertexBuffer::clear() {
+	this->x.clear();
+	this->y.clear();
+	this->z.clear();
+}
+
+void VertexBuffer::assign(const VertexView& vertices) {
+	this->x.assign(vertices.x.begin(), vertices.x.end());
+	this->y.assign(vertices.y.begin(), vertices.y.end());
+	this->z.assign(vertices.z.begin(), vertices.z.end());
+}
+
+unsigned int VertexBuffer::add(const Vector3& vertex) {
+	this->x.push_back(vertex.x);
+	this->y.push_back(vertex.y);
+	this->z.push_back(vertex.z);
+	return static_cast<unsigned int>(this->x.size() - 1);
+}
+
+VertexView VertexBuffer::view(std::size_t count) const {
+	count = std::min(count, this->size());
+	return {this->getX().first(count), this->getY().first(count), this->getZ().first(count)};
+}
+
+std::vector<Vector3> VertexBuffer::toVector() const {
+	std::vector<Vector3> vertices(this->size());
+	for (std::size_t index = 0; index < vertices.size(); ++index) {
+		vertices[index] = (*this)[index];
+	}
+	return vertices;
+}
+
+/// Full batches use the SIMD path, the remainder the matching Vector3 operation
+
+void VertexBuffer::normalize(const std::size_t begin, const std::size_t end) {
+	std::size_t index = begin;
+	for (; index + FloatBatch::Width <= end; index += FloatBatch::Width) {
+		const Vector3Batch vertex = Vector3Batch::load(&this->x[index], &this->y[index], &this->z[index]);
+		vertex.normalized().store(&this->x[index], &this->y[index], &this->z[index]);
+	}
+	for (; index < end; ++index) {
+		this->set(index, (*this)[index].normalized());
+	}
+}
+
+void VertexBuffer::setMidpoints(const std::size_t begin, const std::size_t end,
+	const unsigned int* first, const unsigned int* second) {
+	constexpr unsigned int Width = FloatBatch::Width;
+	alignas(32) float gathered[2][3][Width];
+	const FloatBatch half = FloatBatch::broadcast(0.5f);
+
+	std::size_t index = begin;
+	for (; index + Width <= end; index += Width) {
+		/// Parents lie on earlier levels and are scattered, gather them into SoA lanes
+		for (unsigned int lane = 0; lane < Width; ++lane) {
+			const std::size_t offset = index - begin + lane;
+			for (unsigned int parent = 0; parent < 2; ++parent) {
+				const unsigned int source = parent == 0 ? first[offset] : second[offset];
+				gathered[parent][0][lane] = this->x[source];
+				gathered[parent][1][lane] = this->y[source];
+				gathered[parent][2][lane] = this->z[source];
+			}
+		}
+		const Vector3Batch a = Vector3Batch::load(gathered[0][0], gathered[0][1], gathered[0][2]);
+		const Vector3Batch b = Vector3Batch::load(gathered[1][0], gathered[1][1], gathered[1][2]);
+		((a + b) * half).normalized().store(&this->x[index], &this->y[index], &this->z[index]);
+	}
+	for (; index < end; ++index) {
+		const std::size_t offset = index - begin;
+		this->set(index, (((*this)[first[offset]] + (*this)[second[offset]]) * 0.5f).normalized());
+	}
+}
+
+void VertexBuffer::dot(const VertexBuffer& a, const VertexBuffer& b, const std::size_t begin, const std::size_t end,
+	float* result) {
+	std::size_t index = begin;
+	for (; index + FloatBatch::Width <= end; index += FloatBatch::Width) {
+		const Vector3Batch left = Vector3Batch::load(&a.x[index], &a.y[index], &a.z[index]);
+		const Vector3Batch right = Vector3Batch::load(&b.x[index], &b.y[index], &b.z[index]);
+		left.dot(right).store(result + (index - begin));
+	}
+	for (; index < end; ++index) {
+		result[index - begin] = a[index].dot(b[index]);
+	}
+}
+
+void VertexBuffer::cross(const VertexBuffer& a, const VertexBuffer& b, const std::size_t begin, const std::size_t end,
+	VertexBuffer& result) {
+	std::size_t index = begin;
+	for (; index + FloatBatch::Width <= end; index += FloatBatch::Width) {
+		const Vector3Batch left = Vector3Batch::load(&a.x[index], &a.y[index], &a.z[index]);
+		const Vector3Batch right = Vector3Batch::load(&b.x[index], &b.y[index], &b.z[index]);
+		left.cross(right).store(&result.x[index], &result.y[index], &result.z[index]);
+	}
+	for (; index < end; ++index) {
+		result.set(index, a[index].cross(b[index]));
+	}
+}
+} /// namespace lillugsi::planet
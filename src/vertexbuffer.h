@@ -0,0 +1,74 @@
+#pragma once
+
+#include "vector3.h"
+#include "alignedallocator.h"
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace lillugsi::planet {
+/// Non-owning view of the leading vertices of a VertexBuffer, one span per component
+struct VertexView {
+	std::span<const float> x;
+	std::span<const float> y;
+	std::span<const float> z;
+
+	[[nodiscard]] std::size_t size() const { return this->x.size(); }
+	[[nodiscard]] Vector3 operator[](const std::size_t index) const {
+		return {this->x[index], this->y[index], this->z[index]};
+	}
+};
+
+/// Vertex positions in SoA form: one aligned float array per component.
+/// The batch kernels below walk simd::FloatBatch::Width vertices per step
+/// and round exactly like the matching Vector3 operations.
+class VertexBuffer {
+public:
+	using FloatArray = std::vector<float, AlignedAllocator<float>>;
+
+	[[nodiscard]] std::size_t size() const { return this->x.size(); }
+	[[nodiscard]] bool empty() const { return this->x.empty(); }
+	void resize(std::size_t count);
+	void clear();
+	/// Appends a vertex and returns its index
+	unsigned int add(const Vector3& vertex);
+	/// Replaces all vertices with a copy of the view
+	void assign(const VertexView& vertices);
+
+	[[nodiscard]] Vector3 operator[](const std::size_t index) const {
+		return {this->x[index], this->y[index], this->z[index]};
+	}
+	void set(const std::size_t index, const Vector3& vertex) {
+		this->x[index] = vertex.x;
+		this->y[index] = vertex.y;
+		this->z[index] = vertex.z;
+	}
+
+	/// Component arrays, the first n entries of each are vertices 0 to n - 1
+	[[nodiscard]] std::span<const float> getX() const { return this->x; }
+	[[nodiscard]] std::span<const float> getY() const { return this->y; }
+	[[nodiscard]] std::span<const float> getZ() const { return this->z; }
+	/// The first count vertices (clamped to size) without copying
+	[[nodiscard]] VertexView view(std::size_t count) const;
+	[[nodiscard]] VertexView view() const { return this->view(this->size()); }
+
+	/// Interleaved copy
+	[[nodiscard]] std::vector<Vector3> toVector() const;
+
+	/// Batch kernels over the vertices [begin, end)
+
+	/// Scales each vertex to unit length, zero vectors stay
+	void normalize(std::size_t begin, std::size_t end);
+	/// Vertex begin + i becomes the normalized midpoint of vertices first[i] and second[i]
+	void setMidpoints(std::size_t begin, std::size_t end, const unsigned int* first, const unsigned int* second);
+	/// result[i - begin] = a[i] . b[i]
+	static void dot(const VertexBuffer& a, const VertexBuffer& b, std::size_t begin, std::size_t end, float* result);
+	/// result[i] = a[i] x b[i], result must hold at least end vertices
+	static void cross(const VertexBuffer& a, const VertexBuffer& b, std::size_t begin, std::size_t end, VertexBuffer& result);
+
+private:
+	FloatArray x;
+	FloatArray y;
+	FloatArray z;
+};
+} /// namespace lillugsi::planet
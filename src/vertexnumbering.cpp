@@ -0,0 +1,110 @@
+#include "vertexnumbering.h"
+
+namespace lillugsi::planet {
+VertexNumbering::VertexNumbering(const std::array<std::array<unsigned int, 3>, 20>& baseFaceVertices)
+: baseFaceVertices(baseFaceVertices) {
+	/// Number the 30 edges of the icosahedron in order of first appearance
+	std::uint8_t edgeCount = 0;
+	for (auto& row : this->baseEdges) {
+		row.fill(0xff);
+	}
+	for (const auto& face : baseFaceVertices) {
+		for (unsigned int corner = 0; corner < 3; ++corner) {
+			const unsigned int first = face[corner];
+			const unsigned int second = face[(corner + 1) % 3];
+			if (this->baseEdges[first][second] == 0xff) {
+				this->baseEdges[first][second] = edgeCount;
+				this->baseEdges[second][first] = edgeCount;
+				this->baseEdgeCreators[edgeCount] = static_cast<std::uint8_t>(&face - baseFaceVertices.data());
+				++edgeCount;
+			}
+		}
+	}
+}
+
+bool VertexNumbering::createsMidpoint(const FaceId baseFace, const std::array<LatticePoint, 3>& corners,
+	const unsigned int corner) const {
+	/// Corners of an upward triangle are base + (1,0,0), base + (0,1,0) and base + (0,0,1),
+	/// those of a downward one top - (1,0,0) etc., so the corner sum tells them apart
+	const LatticePoint sum = corners[0] + corners[1] + corners[2];
+	if (sum.a % 3 != 1)
+		return false;
+
+	/// An edge on the border of the base face has a zero coordinate at both ends
+	const LatticePoint& from = corners[corner];
+	const LatticePoint& to = corners[(corner + 1) % 3];
+	for (unsigned int opposite = 0; opposite < 3; ++opposite) {
+		if (from[opposite] == 0 && to[opposite] == 0) {
+			const auto& baseCorners = this->baseFaceVertices[baseFace];
+			const std::uint8_t edge = this->baseEdges[baseCorners[(opposite + 1) % 3]][baseCorners[(opposite + 2) % 3]];
+			return this->baseEdgeCreators[edge] == baseFace;
+		}
+	}
+	return true;
+}
+
+unsigned int VertexNumbering::vertexIndex(const FaceId baseFace, unsigned int level, LatticePoint point) const {
+	/// Find the level on which the vertex was created
+	while (level > 0 && (point.a | point.b | point.c) % 2 == 0) {
+		point = {point.a / 2, point.b / 2, point.c / 2};
+		--level;
+	}
+
+	const auto& corners = this->baseFaceVertices[baseFace];
+	if (level == 0) {
+		return point.a != 0 ? corners[0] : (point.b != 0 ? corners[1] : corners[2]);
+	}
+
+	/// A new vertex halves an edge of the level above: two coordinates are odd,
+	/// the even one tells the direction of the edge
+	const std::uint64_t edgesPerSide = std::uint64_t{1} << (level - 1);
+	const std::uint64_t first = vertexCount(level - 1);
+	const unsigned int even = point.a % 2 == 0 ? 0 : (point.b % 2 == 0 ? 1 : 2);
+	const unsigned int next = (even + 1) % 3;
+	const unsigned int last = (even + 2) % 3;
+
+	if (point[even] == 0) {
+		/// On a base edge, shared with the neighboring base face
+		const unsigned int from = corners[next];
+		const unsigned int to = corners[last];
+		const std::uint64_t position = from < to ? point[last] : point[next];
+		return static_cast<unsigned int>(first + this->baseEdges[from][to] * edgesPerSide + position / 2);
+	}
+
+	/// Inside the base face
+	const std::uint64_t edgesPerDirection = edgesPerSide * (edgesPerSide - 1) / 2;
+	const std::uint64_t row = point[even] / 2; /// 1 .. edgesPerSide - 1
+	const std::uint64_t column = point[next] / 2; /// 0 .. edgesPerSide - row - 1
+	const std::uint64_t rank = (row - 1) * edgesPerSide - (row - 1) * row / 2 + column;
+	return static_cast<unsigned int>(first + 30 * edgesPerSide
+		+ baseFace * 3 * edgesPerDirection + even * edgesPerDirection + rank);
+}
+
+std::array<LatticePoint, 3> VertexNumbering::baseCorners() {
+	return {LatticePoint{1, 0, 0}, LatticePoint{0, 1, 0}, LatticePoint{0, 0, 1}};
+}
+
+std::array<LatticePoint, 3> VertexNumbering::childCorners(const std::array<LatticePoint, 3>& corners,
+	const unsigned int slot) {
+	/// Mirrors Icosphere::subdivideFace, which stores the vertices of a new face in reverse order
+	const LatticePoint mid1 = corners[0] + corners[1];
+	const LatticePoint mid2 = corners[1] + corners[2];
+	const LatticePoint mid3 = corners[2] + corners[0];
+	switch (slot) {
+	case 0: return {mid3, mid1, corners[0].doubled()};
+	case 1: return {mid2, corners[1].doubled(), mid1};
+	case 2: return {corners[2].doubled(), mid2, mid3};
+	default: return {mid3, mid2, mid1};
+	}
+}
+
+std::array<LatticePoint, 3> VertexNumbering::cornersOf(const FaceId id) {
+	const unsigned int level = faceid::levelOf(id);
+	const FaceId path = faceid::pathOf(id);
+	std::array<LatticePoint, 3> corners = baseCorners();
+	for (unsigned int depth = level; depth > 0; --depth) {
+		corners = childCorners(corners, (path >> (2 * (depth - 1))) & 3u);
+	}
+	return corners;
+}
+} /// namespace lillugsi::planet
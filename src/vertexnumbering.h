@@ -0,0 +1,75 @@
+#pragma once
+
+#include "faceid.h"
+#include <array>
+#include <cstdint>
+
+namespace lillugsi::planet {
+/// Point of the triangular lattice of a base face at some level:
+/// barycentric integer coordinates with a + b + c == 2^level, relative to the
+/// three stored vertices of the base face.
+struct LatticePoint {
+	std::uint32_t a, b, c;
+
+	LatticePoint operator+(const LatticePoint& other) const {
+		return {a + other.a, b + other.b, c + other.c};
+	}
+	[[nodiscard]] LatticePoint doubled() const {
+		return {2 * a, 2 * b, 2 * c};
+	}
+	[[nodiscard]] std::uint32_t operator[](unsigned int index) const {
+		return index == 0 ? a : (index == 1 ? b : c);
+	}
+	[[nodiscard]] std::uint32_t& operator[](unsigned int index) {
+		return index == 0 ? a : (index == 1 ? b : c);
+	}
+	bool operator==(const LatticePoint& other) const {
+		return a == other.a && b == other.b && c == other.c;
+	}
+};
+
+/// Analytic vertex numbering of the subdivided icosahedron.
+/// Midpoint indices are computed from the lattice position of the edge, so
+/// subdivision needs no edge-to-midpoint cache and the result does not depend
+/// on the order in which faces are split.
+///
+/// The vertices are numbered level by level: the first vertexCount(n) vertices
+/// form the mesh of level n. The 30 * 4^(n-1) vertices new on level n are the
+/// midpoints of the edges of level n - 1, numbered as
+///   - the 30 base edges, 2^(n-1) midpoints each, counted from the base vertex
+///     with the lower index,
+///   - then per base face the edges inside it, in three directions of
+///     2^(n-1) * (2^(n-1) - 1) / 2 edges each.
+class VertexNumbering {
+public:
+	VertexNumbering() = default;
+	/// Base face vertices in their stored order, indices 0-11
+	explicit VertexNumbering(const std::array<std::array<unsigned int, 3>, 20>& baseFaceVertices);
+
+	/// Number of vertices of a mesh subdivided to the given level, 10 * 4^level + 2
+	static constexpr std::uint64_t vertexCount(const unsigned int level) {
+		return (std::uint64_t{10} << (2 * level)) + 2;
+	}
+
+	/// Vertex index of a lattice point of a base face, which may also be a point of a coarser level
+	[[nodiscard]] unsigned int vertexIndex(FaceId baseFace, unsigned int level, LatticePoint point) const;
+
+	/// Whether the face with these corners creates the midpoint of its edge corner -> corner + 1.
+	/// Every edge has exactly one creator, so faces can be split concurrently: inside a base
+	/// face it is the triangle pointing the same way as the base face, on a base edge the
+	/// base face that lists the edge first.
+	[[nodiscard]] bool createsMidpoint(FaceId baseFace, const std::array<LatticePoint, 3>& corners,
+		unsigned int corner) const;
+
+	/// Lattice corners of a face in the stored order of its vertex indices
+	[[nodiscard]] static std::array<LatticePoint, 3> baseCorners();
+	[[nodiscard]] static std::array<LatticePoint, 3> childCorners(const std::array<LatticePoint, 3>& corners,
+		unsigned int slot);
+	[[nodiscard]] static std::array<LatticePoint, 3> cornersOf(FaceId id);
+
+private:
+	std::array<std::array<unsigned int, 3>, 20> baseFaceVertices{};
+	std::array<std::array<std::uint8_t, 12>, 12> baseEdges{}; /// edge index of each pair of base vertices
+	std::array<std::uint8_t, 30> baseEdgeCreators{}; /// base face that creates the midpoints of each base edge
+};
+} /// namespace lillugsi::planet